@@ -7,6 +7,9 @@
 #ifndef MESH_SEGMENTER_H
 #define MESH_SEGMENTER_H
 
+#include <vector>
+
+#include <vtk_viewer/cell_adjacency.h>
 #include <vtk_viewer/vtk_utils.h>
 #include <vtkPolyData.h>
 #include <vtkTriangleFilter.h>
@@ -18,7 +21,71 @@ namespace mesh_segmenter
   public:
 
     /**
-     * @brief setInputMesh Set the input mesh to be segmented
+     * @brief Algorithms used by segmentMesh()
+     */
+    enum SegmentationMethod
+    {
+      REGION_GROWING,  /**< grow one segment at a time from a seed cell, breadth first */
+      UNION_FIND  /**< check every edge in parallel and merge the cells it joins in a concurrent union-find */
+    };
+
+    /**
+     * @brief constructor, segments with REGION_GROWING on all hardware threads and keeps segments of any size
+     */
+    MeshSegmenter();
+
+    /**
+     * @brief setSegmentationMethod Set the algorithm used by segmentMesh().  Both give the same segments, in the same
+     * order, REGION_GROWING lists the cells of a segment breadth first from its lowest cell id, UNION_FIND lists them by
+     * increasing id.
+     * @param method The segmentation method
+     */
+    void setSegmentationMethod(SegmentationMethod method){method_ = method;}
+
+    /**
+     * @brief getSegmentationMethod Get the algorithm used by segmentMesh()
+     * @return The segmentation method
+     */
+    SegmentationMethod getSegmentationMethod(){return method_;}
+
+    /**
+     * @brief setNumThreads Set the number of threads used to build the table of neighboring cells and by UNION_FIND
+     * @param num_threads The number of threads, 0 (default) uses all hardware threads
+     */
+    void setNumThreads(int num_threads){num_threads_ = num_threads;}
+
+    /**
+     * @brief getNumThreads Get the number of threads used to build the table of neighboring cells and by UNION_FIND
+     * @return The number of threads, 0 means all hardware threads
+     */
+    int getNumThreads(){return num_threads_;}
+
+    /**
+     * @brief setMinSegmentCells Set the number of cells below which segmentMesh() merges a segment into a neighbor
+     * @param min_cells The minimum number of cells of a segment, 0 (default) keeps segments of any size
+     */
+    void setMinSegmentCells(int min_cells){min_segment_cells_ = min_cells;}
+
+    /**
+     * @brief getMinSegmentCells Get the number of cells below which segmentMesh() merges a segment into a neighbor
+     * @return The minimum number of cells of a segment, 0 means segments of any size are kept
+     */
+    int getMinSegmentCells(){return min_segment_cells_;}
+
+    /**
+     * @brief setMinSegmentArea Set the area below which segmentMesh() merges a segment into a neighbor
+     * @param min_area The minimum area of a segment, 0 (default) keeps segments of any area
+     */
+    void setMinSegmentArea(double min_area){min_segment_area_ = min_area;}
+
+    /**
+     * @brief getMinSegmentArea Get the area below which segmentMesh() merges a segment into a neighbor
+     * @return The minimum area of a segment, 0 means segments of any area are kept
+     */
+    double getMinSegmentArea(){return min_segment_area_;}
+
+    /**
+     * @brief setInputMesh Set the input mesh to be segmented, builds the table of neighboring cells
      * @param mesh The input mesh to operate on
      */
     void setInputMesh(vtkSmartPointer<vtkPolyData> mesh);
@@ -30,24 +97,38 @@ namespace mesh_segmenter
     vtkSmartPointer<vtkPolyData> getInputMesh(){return input_mesh_;}
 
     /**
-     * @brief getNeighborCells Given a mesh and a target cell, find all other connecting cells
-     * @param mesh The input mesh to operate on
+     * @brief getNeighborCells Given a mesh and a target cell, find all other connecting cells (looked up in the table
+     * built for the input mesh)
+     * @param mesh The input mesh to operate on, unused
      * @param cellId The cell id to find adjacent cells
      * @return The list of cell ids which are adjacent to the target cell
      */
     vtkSmartPointer<vtkIdList> getNeighborCells(vtkSmartPointer<vtkPolyData> mesh, int cell_id);
 
     /**
-     * @brief segmentMesh Segments the input mesh using the desired segmentation algorithm
+     * @brief segmentMesh Segments the input mesh into regions of adjacent cells with near normals, in time linear in
+     * the number of cells, with the method set by setSegmentationMethod().  Segments are ordered by their lowest cell id.
+     * Segments with fewer cells or less area than the minimums are then merged into the neighboring segment with the
+     * closest average normal, a merged segment takes the place of the segment it was merged into and its cells follow
+     * the cells of that segment.
      */
     void segmentMesh();
 
     /**
-     * @brief getMeshSegments Get the segments of the mesh after segmentation has been performed
+     * @brief getMeshSegments Get the segments of the mesh after segmentation has been performed.  Each segment holds its
+     * cells and only the points they use, with the point and cell data (normals) of the input mesh.  The segments are
+     * extracted in a single pass over their cells, segments of a single cell are left out.
      * @return The vector of mesh segments
      */
     std::vector<vtkSmartPointer<vtkPolyData> > getMeshSegments();
 
+    /**
+     * @brief getSegmentCellIds Get the cell ids of every segment after segmentation has been performed, including the
+     * segments of a single cell which getMeshSegments() leaves out
+     * @return The list of cell ids of each segment, in the order of segmentMesh()
+     */
+    std::vector<vtkSmartPointer<vtkIdList> > getSegmentCellIds(){return included_indices_;}
+
     /**
      * @brief segmentMesh Performs segmentation on the input mesh, starting at the start_cell id
      * @param start_cell The id of the cell to start segmentation at
@@ -66,8 +147,37 @@ namespace mesh_segmenter
 
   private:
 
+    /**
+     * @brief growSegment Finds the cells connected to the start cell by adjacent cells with near normals, breadth first
+     * @param start_cell The id of the cell to start at
+     * @param normals The cell normals of the input mesh
+     * @param visited [in/out] Marks the cells added to a segment, the cells of the new segment are marked
+     * @return The list of ids of the segment
+     */
+    vtkSmartPointer<vtkIdList> growSegment(vtkIdType start_cell, vtkDataArray* normals, std::vector<bool>& visited);
+
+    /**
+     * @brief segmentUnionFind Segments the input mesh by checking the normals across every edge in parallel, merging
+     * the cells of each edge which passes in a union-find and collecting the cells of every set into a segment
+     * @param normals The cell normals of the input mesh
+     */
+    void segmentUnionFind(vtkDataArray* normals);
+
+    /**
+     * @brief mergeSmallSegments Merges every segment with fewer cells or less area than the minimums into the
+     * neighboring segment with the closest area weighted average normal, smallest segments first.  Segments without
+     * neighbors are kept.
+     * @param normals The cell normals of the input mesh
+     */
+    void mergeSmallSegments(vtkDataArray* normals);
+
+    SegmentationMethod method_;  /**< The algorithm used by segmentMesh() */
+    int num_threads_;  /**< The number of threads used, 0 for all hardware threads */
+    int min_segment_cells_;  /**< Segments with fewer cells are merged into a neighbor, 0 to keep all */
+    double min_segment_area_;  /**< Segments with less area are merged into a neighbor, 0 to keep all */
     vtkSmartPointer<vtkPolyData> input_mesh_;  /**< The input mesh to segment */
     vtkSmartPointer<vtkTriangleFilter> triangle_filter_;  /**< VTK triangle filter for finding adjacent cells */
+    vtk_viewer::CellAdjacency adjacency_;  /**< The cells sharing an edge with each cell of the triangle filter output */
     std::vector<vtkSmartPointer<vtkIdList> > included_indices_;
       /**< A list of all indices which indicates which cells belong to which segmentation chuncks */
   };
@@ -4,18 +4,156 @@
  *
  */
 
+#include <algorithm>
+#include <atomic>
+#include <queue>
+
 #include <vtkIdList.h>
 #include <vtkDataArray.h>
 #include <vtkCellData.h>
 #include <vtkPointData.h>
 #include <vtkDoubleArray.h>
 #include <vtkFloatArray.h>
+#include <vtkMath.h>
 
+#include <vtk_viewer/thread_pool.h>
+#include <vtk_viewer/trace.h>
 #include <mesh_segmenter/mesh_segmenter.h>
 
 namespace mesh_segmenter
 {
 
+namespace
+{
+  const vtkIdType MIN_PARALLEL_CELLS = 1 << 16;  /**< Fewer cells are segmented on the calling thread only */
+  const int CHUNKS_PER_THREAD = 8;  /**< The cells are split in this many chunks per thread to balance the load */
+
+  /**
+   * @brief findRoot Finds the root of the set of a cell, halving the path on the way, safe to call concurrently
+   * @param parents The parent of every cell, roots are their own parent
+   * @param cell The cell id
+   * @return The root
+   */
+  vtkIdType findRoot(std::vector<std::atomic<vtkIdType> >& parents, vtkIdType cell)
+  {
+    while(true)
+    {
+      vtkIdType parent = parents[cell].load();
+      if(parent == cell)
+      {
+        return cell;
+      }
+
+      // parents only ever move closer to the root, so a failed update can be ignored
+      vtkIdType grandparent = parents[parent].load();
+      if(grandparent != parent)
+      {
+        parents[cell].compare_exchange_weak(parent, grandparent);
+      }
+      cell = grandparent;
+    }
+  }
+
+  /**
+   * @brief unite Merges the sets of two cells, safe to call concurrently.  The higher root is linked below the lower
+   * one, so the root of a set is always its lowest cell id.
+   * @param parents The parent of every cell, roots are their own parent
+   * @param a The first cell id
+   * @param b The second cell id
+   */
+  void unite(std::vector<std::atomic<vtkIdType> >& parents, vtkIdType a, vtkIdType b)
+  {
+    while(true)
+    {
+      a = findRoot(parents, a);
+      b = findRoot(parents, b);
+      if(a == b)
+      {
+        return;
+      }
+      if(a < b)
+      {
+        std::swap(a, b);
+      }
+
+      // retry if another thread linked the root somewhere else first
+      vtkIdType expected = a;
+      if(parents[a].compare_exchange_strong(expected, b))
+      {
+        return;
+      }
+    }
+  }
+
+  /**
+   * @brief cellArea Computes the area of a polygon of a mesh from the triangles of a fan around its first point
+   * @param mesh The mesh
+   * @param cell The cell id
+   * @return The area, 0 for cells of less than 3 points
+   */
+  double cellArea(vtkPolyData* mesh, vtkIdType cell)
+  {
+    vtkIdType npts;
+    vtkIdType* pts;
+    mesh->GetCellPoints(cell, npts, pts);
+    if(npts < 3)
+    {
+      return 0.0;
+    }
+
+    double p0[3];
+    double sum[3] = {0.0, 0.0, 0.0};
+    mesh->GetPoint(pts[0], p0);
+    for(vtkIdType k = 1; k + 1 < npts; ++k)
+    {
+      double p1[3], p2[3], a[3], b[3], c[3];
+      mesh->GetPoint(pts[k], p1);
+      mesh->GetPoint(pts[k + 1], p2);
+      vtkMath::Subtract(p1, p0, a);
+      vtkMath::Subtract(p2, p0, b);
+      vtkMath::Cross(a, b, c);
+      vtkMath::Add(sum, c, sum);
+    }
+    return 0.5 * vtkMath::Norm(sum);
+  }
+
+  /**
+   * @brief normalCosine Computes the cosine of the angle between two vectors which need not be normalized
+   * @param a The first vector
+   * @param b The second vector
+   * @return The cosine, -1 if either vector is zero
+   */
+  double normalCosine(const double* a, const double* b)
+  {
+    double norms = vtkMath::Norm(a) * vtkMath::Norm(b);
+    return norms > 0.0 ? vtkMath::Dot(a, b) / norms : -1.0;
+  }
+
+  /**
+   * @brief findSegment Finds the segment a segment was merged into, halving the path on the way
+   * @param merged_into The segment every segment was merged into, segments which were not merged point to themselves
+   * @param segment The segment index
+   * @return The index of the segment holding its cells
+   */
+  int findSegment(std::vector<int>& merged_into, int segment)
+  {
+    while(merged_into[segment] != segment)
+    {
+      merged_into[segment] = merged_into[merged_into[segment]];
+      segment = merged_into[segment];
+    }
+    return segment;
+  }
+}
+
+MeshSegmenter::MeshSegmenter():
+  method_(REGION_GROWING),
+  num_threads_(0),
+  min_segment_cells_(0),
+  min_segment_area_(0.0)
+{
+}
+
 void MeshSegmenter::setInputMesh(vtkSmartPointer<vtkPolyData> mesh)
 {
   input_mesh_ = mesh;
@@ -26,34 +164,74 @@ void MeshSegmenter::setInputMesh(vtkSmartPointer<vtkPolyData> mesh)
   }
   triangle_filter_->SetInputData(input_mesh_);
   triangle_filter_->Update();
+
+  // look up the neighbors of every cell once instead of on every visit while segmenting
+  adjacency_.build(triangle_filter_->GetOutput(), num_threads_);
 }
 
 std::vector<vtkSmartPointer<vtkPolyData> > MeshSegmenter::getMeshSegments()
 {
-  vtkSmartPointer<vtkPolyData> input_copy = vtkSmartPointer<vtkPolyData>::New();
-  input_copy->DeepCopy(input_mesh_);
+  vtk_viewer::TraceSpan span("MeshSegmenter::getMeshSegments");
+
   std::vector<vtkSmartPointer<vtkPolyData> > meshes;
-  for(int i = 0; i < included_indices_.size(); ++i)
+  if(!input_mesh_ || !input_mesh_->GetPoints())
   {
+    return meshes;
+  }
 
-    vtkSmartPointer<vtkPolyData> mesh = vtkSmartPointer<vtkPolyData>::New();
-    mesh->DeepCopy(input_mesh_);
-    mesh->GetPoints()->Initialize();
-    mesh->GetPolys()->Initialize();
-    input_copy->GetCellData()->CopyNormalsOn();
-
-    // Preallocate memory, this is NECESSARY or normal data is NOT copied
-    mesh->GetCellData()->CopyAllocate(input_copy->GetCellData(), included_indices_[i]->GetNumberOfIds(), included_indices_[i]->GetNumberOfIds());
-    mesh->GetPointData()->CopyAllocate(input_copy->GetPointData(), included_indices_[i]->GetNumberOfIds()*2, included_indices_[i]->GetNumberOfIds()*2);
+  vtkPoints* input_points = input_mesh_->GetPoints();
+  vtkPointData* input_point_data = input_mesh_->GetPointData();
+  vtkCellData* input_cell_data = input_mesh_->GetCellData();
+  input_mesh_->BuildCells();
 
-    // copy cell data and normals
-    mesh->CopyCells(input_copy, included_indices_[i]);
+  // the id of every input point in the segment which used it last, so the map never needs to be cleared
+  std::vector<int> point_segment(input_mesh_->GetNumberOfPoints(), -1);
+  std::vector<vtkIdType> point_ids(input_mesh_->GetNumberOfPoints());
+  std::vector<vtkIdType> cell_points;
 
-    if(mesh->GetNumberOfCells() <= 1)
+  for(int i = 0; i < included_indices_.size(); ++i)
+  {
+    vtkIdList* cells = included_indices_[i];
+    if(cells->GetNumberOfIds() <= 1)
     {
       cout << "NOT ENOUGH CELLS FOR SEGMENTATION\n";
       continue;
     }
+
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->SetDataType(input_points->GetDataType());
+
+    vtkSmartPointer<vtkPolyData> mesh = vtkSmartPointer<vtkPolyData>::New();
+    mesh->SetPoints(points);
+    mesh->Allocate(cells->GetNumberOfIds());
+    mesh->GetPointData()->CopyNormalsOn();
+    mesh->GetCellData()->CopyNormalsOn();
+    mesh->GetPointData()->CopyAllocate(input_point_data, cells->GetNumberOfIds());
+    mesh->GetCellData()->CopyAllocate(input_cell_data, cells->GetNumberOfIds());
+
+    // copy the cells with their data, and their points with their data the first time the segment uses them
+    for(vtkIdType j = 0; j < cells->GetNumberOfIds(); ++j)
+    {
+      vtkIdType cell = cells->GetId(j);
+      vtkIdType npts;
+      vtkIdType* pts;
+      input_mesh_->GetCellPoints(cell, npts, pts);
+      cell_points.resize(npts);
+      for(vtkIdType k = 0; k < npts; ++k)
+      {
+        if(point_segment[pts[k]] != i)
+        {
+          point_segment[pts[k]] = i;
+          point_ids[pts[k]] = points->InsertNextPoint(input_points->GetPoint(pts[k]));
+          mesh->GetPointData()->CopyData(input_point_data, pts[k], point_ids[pts[k]]);
+        }
+        cell_points[k] = point_ids[pts[k]];
+      }
+      vtkIdType new_cell = mesh->InsertNextCell(input_mesh_->GetCellType(cell), npts, cell_points.data());
+      mesh->GetCellData()->CopyData(input_cell_data, cell, new_cell);
+    }
+
+    mesh->Squeeze();
     meshes.push_back(mesh);
   }
 
@@ -62,107 +240,334 @@ std::vector<vtkSmartPointer<vtkPolyData> > MeshSegmenter::getMeshSegments()
 
 void MeshSegmenter::segmentMesh()
 {
-  vtkSmartPointer<vtkIdList> used_cells = vtkSmartPointer<vtkIdList>::New();
-  int size = input_mesh_->GetCellData()->GetNumberOfTuples();
-
-  used_cells->Allocate(size);
+  vtk_viewer::TraceSpan span("MeshSegmenter::segmentMesh");
 
   included_indices_.clear();
 
-  for(int i = 0; i < size; ++i)
+  vtkDataArray* normals = input_mesh_->GetCellData()->GetNormals();
+  if(!normals)
   {
-    // if current index is not used, perform segmentation with it and insert the results into the list
-    if(used_cells->IsId(i) == -1)
-    {
-      vtkSmartPointer<vtkIdList> linked_cells = vtkSmartPointer<vtkIdList>::New();
-      linked_cells = segmentMesh(i);
+    return;
+  }
 
-      // save indices found
-      included_indices_.push_back(linked_cells);
-      for(int j = 0; j < linked_cells->GetNumberOfIds(); ++j)
+  if(method_ == UNION_FIND)
+  {
+    segmentUnionFind(normals);
+  }
+  else
+  {
+    // every cell belongs to exactly one segment, grow a new segment from each cell not reached yet
+    vtkIdType size = normals->GetNumberOfTuples();
+    std::vector<bool> visited(size, false);
+    for(vtkIdType i = 0; i < size; ++i)
+    {
+      if(!visited[i])
       {
-        used_cells->InsertNextId(linked_cells->GetId(j));
+        included_indices_.push_back(growSegment(i, normals, visited));
       }
     }
   }
+
+  if(min_segment_cells_ > 0 || min_segment_area_ > 0.0)
+  {
+    mergeSmallSegments(normals);
+  }
 }
 
 vtkSmartPointer<vtkIdList> MeshSegmenter::segmentMesh(int start_cell)
 {
-  // Create the links object
-  vtkSmartPointer<vtkIdList> unused_cells = vtkSmartPointer<vtkIdList>::New();
-  vtkSmartPointer<vtkIdList> used_cells = vtkSmartPointer<vtkIdList>::New();
-
   vtkDataArray* normals = input_mesh_->GetCellData()->GetNormals();
 
   if(!normals)
   {
-    return used_cells;
+    return vtkSmartPointer<vtkIdList>::New();
   }
 
-  // Insert the start cell
-  unused_cells->InsertNextId(start_cell);
+  std::vector<bool> visited(normals->GetNumberOfTuples(), false);
+  return growSegment(start_cell, normals, visited);
+}
+
+vtkSmartPointer<vtkIdList> MeshSegmenter::growSegment(vtkIdType start_cell, vtkDataArray* normals,
+                                                      std::vector<bool>& visited)
+{
+  vtkSmartPointer<vtkIdList> used_cells = vtkSmartPointer<vtkIdList>::New();
+
+  // cells are marked when they are queued so they are queued only once
+  std::queue<vtkIdType> unused_cells;
+  unused_cells.push(start_cell);
+  visited[start_cell] = true;
 
   // Loop and find all connected cells
-  while(unused_cells->GetNumberOfIds())
+  while(!unused_cells.empty())
   {
-    vtkSmartPointer<vtkIdList> neighbors = vtkSmartPointer<vtkIdList>::New();
-    neighbors = getNeighborCells(input_mesh_, unused_cells->GetId(0));
+    vtkIdType cell = unused_cells.front();
+    unused_cells.pop();
+    used_cells->InsertNextId(cell);
 
-    // check to see if neighbors are in the used/unused list
-    for(int i = 0; i < neighbors->GetNumberOfIds(); ++i)
+    if(cell >= adjacency_.getNumberOfCells())
     {
+      continue;
+    }
 
-      // if a cell has not been seen, check the angle to determine if it should be added to the unused list
-      if(unused_cells->IsId(neighbors->GetId(i)) == -1 && used_cells->IsId(neighbors->GetId(i)) == -1)
+    double n1[3];
+    normals->GetTuple(cell, n1);
+
+    // check the angle of every neighbor not seen yet, insert it if it is valid
+    const vtkIdType* neighbors = adjacency_.getNeighbors(cell);
+    for(vtkIdType i = 0; i < adjacency_.getNumberOfNeighbors(cell); ++i)
+    {
+      vtkIdType neighbor = neighbors[i];
+      if(neighbor < visited.size() && !visited[neighbor])
       {
-        //check angle, insert if it is valid
-        const double* const n1 = normals->GetTuple(unused_cells->GetId(0));
-        // vtk does not return a const ptr, need to make a copy before getting next pointer
-        double val[3] = {n1[0], n1[1], n1[2]};
-        const double* const n2 = normals->GetTuple(neighbors->GetId(i));
-        if( areNormalsNear(&val[0], n2, 0.3) )
+        double n2[3];
+        normals->GetTuple(neighbor, n2);
+        if(areNormalsNear(n1, n2, 0.3))
         {
-          unused_cells->InsertNextId(neighbors->GetId(i));
+          visited[neighbor] = true;
+          unused_cells.push(neighbor);
         }
       }
     }
-
-    // Once all adjacent cells have been checked, move the first unused_cell to the used_cell list
-    used_cells->InsertNextId(unused_cells->GetId(0));
-    unused_cells->DeleteId(unused_cells->GetId(0));
   }
 
   // return id list
   return used_cells;
 }
 
-vtkSmartPointer<vtkIdList> MeshSegmenter::getNeighborCells(vtkSmartPointer<vtkPolyData> mesh, int cell_id)
+void MeshSegmenter::segmentUnionFind(vtkDataArray* normals)
 {
-  vtkSmartPointer<vtkIdList> cell_point_ids = vtkSmartPointer<vtkIdList>::New();
-  triangle_filter_->GetOutput()->GetCellPoints(cell_id, cell_point_ids);
+  vtkIdType size = normals->GetNumberOfTuples();
+  vtk_viewer::ThreadPool pool(size < MIN_PARALLEL_CELLS ? 1 : num_threads_);
+  int chunks = std::max<vtkIdType>(1, std::min<vtkIdType>(size, pool.getNumThreads() * CHUNKS_PER_THREAD));
 
-  vtkSmartPointer<vtkIdList> neighbors = vtkSmartPointer<vtkIdList>::New();
+  std::vector<std::atomic<vtkIdType> > parents(size);
+  pool.parallelFor(chunks, [&](int chunk, int)
+  {
+    for(vtkIdType i = size * chunk / chunks; i < size * (chunk + 1) / chunks; ++i)
+    {
+      parents[i].store(i);
+    }
+  });
 
-  for(vtkIdType i = 0; i < cell_point_ids->GetNumberOfIds(); i++)
+  // every edge is checked by its lower cell, the criterion is symmetric so this is the check region growing does
+  vtkIdType num_cells = std::min(size, adjacency_.getNumberOfCells());
+  pool.parallelFor(chunks, [&](int chunk, int)
   {
-    vtkSmartPointer<vtkIdList> id_list = vtkSmartPointer<vtkIdList>::New();
+    for(vtkIdType i = num_cells * chunk / chunks; i < num_cells * (chunk + 1) / chunks; ++i)
+    {
+      double n1[3];
+      normals->GetTuple(i, n1);
+      const vtkIdType* neighbors = adjacency_.getNeighbors(i);
+      for(vtkIdType j = 0; j < adjacency_.getNumberOfNeighbors(i); ++j)
+      {
+        vtkIdType neighbor = neighbors[j];
+        if(neighbor > i && neighbor < size)
+        {
+          double n2[3];
+          normals->GetTuple(neighbor, n2);
+          if(areNormalsNear(n1, n2, 0.3))
+          {
+            unite(parents, i, neighbor);
+          }
+        }
+      }
+    }
+  });
 
-    //add one of the edge points
-    id_list->InsertNextId(cell_point_ids->GetId(i));
+  std::vector<vtkIdType> labels(size);
+  pool.parallelFor(chunks, [&](int chunk, int)
+  {
+    for(vtkIdType i = size * chunk / chunks; i < size * (chunk + 1) / chunks; ++i)
+    {
+      labels[i] = findRoot(parents, i);
+    }
+  });
 
-    //add the other edge point
-    id_list->InsertNextId(cell_point_ids->GetId((i+1) % (cell_point_ids->GetNumberOfIds() )  ));
+  // number the sets by their root, which is their lowest cell, so they come in the order region growing seeds them
+  std::vector<vtkIdType> counts;
+  for(vtkIdType i = 0; i < size; ++i)
+  {
+    if(labels[i] == i)
+    {
+      labels[i] = counts.size();
+      counts.push_back(0);
+    }
+    else
+    {
+      labels[i] = labels[labels[i]];
+    }
+    ++counts[labels[i]];
+  }
 
-    //get the neighbors of the cell
-    vtkSmartPointer<vtkIdList> neighbor_cell_ids = vtkSmartPointer<vtkIdList>::New();
+  included_indices_.resize(counts.size());
+  for(int i = 0; i < counts.size(); ++i)
+  {
+    included_indices_[i] = vtkSmartPointer<vtkIdList>::New();
+    included_indices_[i]->SetNumberOfIds(counts[i]);
+    counts[i] = 0;
+  }
+  for(vtkIdType i = 0; i < size; ++i)
+  {
+    included_indices_[labels[i]]->SetId(counts[labels[i]]++, i);
+  }
+}
 
-    triangle_filter_->GetOutput()->GetCellNeighbors(cell_id, id_list, neighbor_cell_ids);
-    for(vtkIdType j = 0; j < neighbor_cell_ids->GetNumberOfIds(); j++)
+void MeshSegmenter::mergeSmallSegments(vtkDataArray* normals)
+{
+  vtk_viewer::TraceSpan span("MeshSegmenter::mergeSmallSegments");
+
+  vtkIdType size = normals->GetNumberOfTuples();
+  int num_segments = included_indices_.size();
+  input_mesh_->BuildCells();
+
+  // the segment of every cell, and the size and area weighted normal of every segment
+  std::vector<int> labels(size);
+  std::vector<vtkIdType> cell_counts(num_segments);
+  std::vector<double> areas(num_segments, 0.0);
+  std::vector<double> normal_sums(3 * num_segments, 0.0);
+  for(int i = 0; i < num_segments; ++i)
+  {
+    cell_counts[i] = included_indices_[i]->GetNumberOfIds();
+    for(vtkIdType j = 0; j < cell_counts[i]; ++j)
     {
-      neighbors->InsertNextId(neighbor_cell_ids->GetId(j));
+      vtkIdType cell = included_indices_[i]->GetId(j);
+      double area = cellArea(input_mesh_, cell);
+      double n[3];
+      normals->GetTuple(cell, n);
+      labels[cell] = i;
+      areas[i] += area;
+      for(int k = 0; k < 3; ++k)
+      {
+        normal_sums[3 * i + k] += area * n[k];
+      }
     }
+  }
+
+  auto is_small = [&](int segment)
+  {
+    return (min_segment_cells_ > 0 && cell_counts[segment] < min_segment_cells_) ||
+        (min_segment_area_ > 0.0 && areas[segment] < min_segment_area_);
+  };
 
+  // merge the smallest segments first, so the noise around a surface joins it before the segments it borders are judged
+  std::vector<int> order;
+  for(int i = 0; i < num_segments; ++i)
+  {
+    if(is_small(i))
+    {
+      order.push_back(i);
+    }
+  }
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b){return cell_counts[a] < cell_counts[b];});
+
+  // the segments whose cells every segment holds, in the order they are listed
+  std::vector<int> merged_into(num_segments);
+  std::vector<std::vector<int> > parts(num_segments);
+  for(int i = 0; i < num_segments; ++i)
+  {
+    merged_into[i] = i;
+    parts[i].push_back(i);
+  }
+
+  for(int i = 0; i < order.size(); ++i)
+  {
+    // a segment is only merged on its own turn, but it may have grown enough from the segments merged into it
+    int segment = order[i];
+    if(!is_small(segment))
+    {
+      continue;
+    }
+
+    int best = -1;
+    double best_cosine = -2.0;
+    for(int p = 0; p < parts[segment].size(); ++p)
+    {
+      vtkIdList* cells = included_indices_[parts[segment][p]];
+      for(vtkIdType j = 0; j < cells->GetNumberOfIds(); ++j)
+      {
+        vtkIdType cell = cells->GetId(j);
+        if(cell >= adjacency_.getNumberOfCells())
+        {
+          continue;
+        }
+
+        const vtkIdType* neighbors = adjacency_.getNeighbors(cell);
+        for(vtkIdType k = 0; k < adjacency_.getNumberOfNeighbors(cell); ++k)
+        {
+          if(neighbors[k] >= size)
+          {
+            continue;
+          }
+          int other = findSegment(merged_into, labels[neighbors[k]]);
+          if(other != segment)
+          {
+            double cosine = normalCosine(&normal_sums[3 * segment], &normal_sums[3 * other]);
+            if(cosine > best_cosine)
+            {
+              best_cosine = cosine;
+              best = other;
+            }
+          }
+        }
+      }
+    }
+
+    if(best < 0)
+    {
+      continue;
+    }
+
+    merged_into[segment] = best;
+    cell_counts[best] += cell_counts[segment];
+    areas[best] += areas[segment];
+    for(int k = 0; k < 3; ++k)
+    {
+      normal_sums[3 * best + k] += normal_sums[3 * segment + k];
+    }
+    parts[best].insert(parts[best].end(), parts[segment].begin(), parts[segment].end());
+    std::vector<int>().swap(parts[segment]);
+  }
+
+  // collect the cells of the segments which are left, in their original order
+  std::vector<vtkSmartPointer<vtkIdList> > segments;
+  for(int i = 0; i < num_segments; ++i)
+  {
+    if(merged_into[i] != i)
+    {
+      continue;
+    }
+    if(parts[i].size() == 1)
+    {
+      segments.push_back(included_indices_[i]);
+      continue;
+    }
+
+    vtkSmartPointer<vtkIdList> cells = vtkSmartPointer<vtkIdList>::New();
+    cells->SetNumberOfIds(cell_counts[i]);
+    vtkIdType next = 0;
+    for(int p = 0; p < parts[i].size(); ++p)
+    {
+      vtkIdList* part = included_indices_[parts[i][p]];
+      for(vtkIdType j = 0; j < part->GetNumberOfIds(); ++j)
+      {
+        cells->SetId(next++, part->GetId(j));
+      }
+    }
+    segments.push_back(cells);
+  }
+  included_indices_.swap(segments);
+}
+
+vtkSmartPointer<vtkIdList> MeshSegmenter::getNeighborCells(vtkSmartPointer<vtkPolyData> mesh, int cell_id)
+{
+  vtkSmartPointer<vtkIdList> neighbors = vtkSmartPointer<vtkIdList>::New();
+  if(cell_id >= 0 && cell_id < adjacency_.getNumberOfCells())
+  {
+    const vtkIdType* ids = adjacency_.getNeighbors(cell_id);
+    for(vtkIdType i = 0; i < adjacency_.getNumberOfNeighbors(cell_id); ++i)
+    {
+      neighbors->InsertNextId(ids[i]);
+    }
   }
   return neighbors;
 }
@@ -4,8 +4,11 @@
  *
  */
 
+#include <algorithm>
+
 #include <vtk_viewer/vtk_utils.h>
 #include <vtk_viewer/vtk_viewer.h>
+#include <vtkCellArray.h>
 #include <vtkCellData.h>
 #include <vtkPointData.h>
 #include <vtkCellData.h>
@@ -16,6 +19,7 @@
 
 #include <gtest/gtest.h>
 #include <mesh_segmenter/mesh_segmenter.h>
+#include <vtk_viewer/mesh_generator.h>
 
 // This test displays the output of the mesh segmenter as applied to a cube.  Result should be
 // a cube with each face colored a different color.
@@ -74,6 +78,128 @@ TEST(ViewerTest, TestCase1)
 
 }
 
+// This test segments a large smooth surface with holes, it must stay a single segment which holds every cell once,
+// the same cells as growing a segment from the first cell
+
+TEST(ViewerTest, TestCaseLargeMesh)
+{
+  vtkSmartPointer<vtkPolyData> data = vtk_viewer::createSurfaceMesh(vtk_viewer::SINUSOIDAL_SURFACE, 200000, 1.0, 3);
+
+  mesh_segmenter::MeshSegmenter seg;
+  seg.setInputMesh(data);
+  seg.segmentMesh();
+  std::vector<vtkSmartPointer<vtkPolyData> > meshes = seg.getMeshSegments();
+  ASSERT_EQ(meshes.size(), 1);
+  EXPECT_EQ(meshes[0]->GetNumberOfCells(), data->GetNumberOfCells());
+
+  vtkSmartPointer<vtkIdList> cells = seg.segmentMesh(0);
+  ASSERT_EQ(cells->GetNumberOfIds(), data->GetNumberOfCells());
+  std::vector<bool> found(data->GetNumberOfCells(), false);
+  for(vtkIdType i = 0; i < cells->GetNumberOfIds(); ++i)
+  {
+    EXPECT_FALSE(found[cells->GetId(i)]);
+    found[cells->GetId(i)] = true;
+  }
+}
+
+// This test segments a noisy surface, which falls apart in many segments, with both segmentation methods, they must
+// give the same segments, holding the same cells, in the same order
+
+TEST(ViewerTest, TestCaseUnionFind)
+{
+  vtkSmartPointer<vtkPolyData> data = vtk_viewer::createSurfaceMesh(vtk_viewer::FREEFORM_SURFACE, 100000, 1.0, 2,
+                                                                    0.0015, 1);
+
+  mesh_segmenter::MeshSegmenter region_growing;
+  region_growing.setInputMesh(data);
+  region_growing.segmentMesh();
+  std::vector<vtkSmartPointer<vtkIdList> > expected = region_growing.getSegmentCellIds();
+  ASSERT_GT(expected.size(), 1);
+
+  mesh_segmenter::MeshSegmenter union_find;
+  union_find.setSegmentationMethod(mesh_segmenter::MeshSegmenter::UNION_FIND);
+  union_find.setNumThreads(4);
+  union_find.setInputMesh(data);
+  union_find.segmentMesh();
+  std::vector<vtkSmartPointer<vtkIdList> > segments = union_find.getSegmentCellIds();
+  ASSERT_EQ(segments.size(), expected.size());
+
+  // region growing lists the cells of a segment breadth first, union-find by increasing id
+  for(int i = 0; i < segments.size(); ++i)
+  {
+    std::vector<vtkIdType> cells(segments[i]->GetPointer(0),
+                                 segments[i]->GetPointer(0) + segments[i]->GetNumberOfIds());
+    std::vector<vtkIdType> expected_cells(expected[i]->GetPointer(0),
+                                          expected[i]->GetPointer(0) + expected[i]->GetNumberOfIds());
+    std::sort(expected_cells.begin(), expected_cells.end());
+    EXPECT_TRUE(std::is_sorted(cells.begin(), cells.end()));
+    EXPECT_EQ(cells, expected_cells) << "segment " << i;
+  }
+}
+
+// This test extracts the segments of a noisy surface, each segment must hold only the points its cells use and carry
+// the point and cell normals of the input mesh
+
+TEST(ViewerTest, TestCaseSegmentExtraction)
+{
+  vtkSmartPointer<vtkPolyData> data = vtk_viewer::createSurfaceMesh(vtk_viewer::FREEFORM_SURFACE, 20000, 1.0, 2,
+                                                                    0.004, 1);
+
+  mesh_segmenter::MeshSegmenter seg;
+  seg.setInputMesh(data);
+  seg.segmentMesh();
+  std::vector<vtkSmartPointer<vtkPolyData> > meshes = seg.getMeshSegments();
+  ASSERT_GT(meshes.size(), 1);
+  for(int i = 0; i < meshes.size(); ++i)
+  {
+    std::vector<bool> used(meshes[i]->GetNumberOfPoints(), false);
+    vtkIdType npts;
+    vtkIdType* pts;
+    vtkCellArray* polys = meshes[i]->GetPolys();
+    for(polys->InitTraversal(); polys->GetNextCell(npts, pts);)
+    {
+      for(vtkIdType j = 0; j < npts; ++j)
+      {
+        used[pts[j]] = true;
+      }
+    }
+    EXPECT_EQ(std::count(used.begin(), used.end(), true), meshes[i]->GetNumberOfPoints());
+
+    ASSERT_TRUE(meshes[i]->GetPointData()->GetNormals());
+    ASSERT_TRUE(meshes[i]->GetCellData()->GetNormals());
+    EXPECT_EQ(meshes[i]->GetPointData()->GetNormals()->GetNumberOfTuples(), meshes[i]->GetNumberOfPoints());
+    EXPECT_EQ(meshes[i]->GetCellData()->GetNormals()->GetNumberOfTuples(), meshes[i]->GetNumberOfCells());
+  }
+}
+
+// This test segments a noisy surface with a minimum segment size, the small segments must be merged into their
+// neighbors so fewer segments are left, none of them below the minimum, which still hold every cell
+
+TEST(ViewerTest, TestCaseMergeSmallSegments)
+{
+  vtkSmartPointer<vtkPolyData> data = vtk_viewer::createSurfaceMesh(vtk_viewer::FREEFORM_SURFACE, 20000, 1.0, 2,
+                                                                    0.004, 1);
+
+  mesh_segmenter::MeshSegmenter seg;
+  seg.setInputMesh(data);
+  seg.segmentMesh();
+  std::vector<vtkSmartPointer<vtkPolyData> > unmerged = seg.getMeshSegments();
+
+  seg.setMinSegmentCells(50);
+  seg.segmentMesh();
+  std::vector<vtkSmartPointer<vtkPolyData> > meshes = seg.getMeshSegments();
+  ASSERT_GT(meshes.size(), 0);
+  EXPECT_LT(meshes.size(), unmerged.size());
+
+  vtkIdType cells = 0;
+  for(int i = 0; i < meshes.size(); ++i)
+  {
+    EXPECT_GE(meshes[i]->GetNumberOfCells(), 50);
+    cells += meshes[i]->GetNumberOfCells();
+  }
+  EXPECT_EQ(cells, data->GetNumberOfCells());
+}
+
 // Run all the tests that were declared with TEST()
 int main(int argc, char **argv)
 {
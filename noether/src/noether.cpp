@@ -4,10 +4,13 @@
  *
  */
 
+#include <memory>
+
 #include "noether/noether.h"
 #include <vtkPointData.h>
 #include <ros/ros.h>
 #include <ros/file_log.h>
+#include <vtk_viewer/trace.h>
 
 namespace noether {
 
@@ -135,10 +138,19 @@ int main(int argc, char **argv)
   std::string file;
   pnh.param<std::string>("filename", file, "");
 
+  // Chrome trace event file of the planning pipeline, not traced if empty
+  std::string trace_file;
+  pnh.param<std::string>("trace_file", trace_file, "");
+  if(!trace_file.empty())
+  {
+    vtk_viewer::Trace::start();
+  }
+
 
   if(!file.empty())
   {
     // read data file
+    std::unique_ptr<vtk_viewer::TraceSpan> load_span(new vtk_viewer::TraceSpan("load"));
     vtkSmartPointer<vtkPolyData> data = vtkSmartPointer<vtkPolyData>::New();
     std::vector<char> buffer (file.size() + 1, '\0');
     char* str = buffer.data();
@@ -185,6 +197,8 @@ int main(int argc, char **argv)
       return 1;
     }
 
+    load_span.reset();
+
     vtk_viewer::generateNormals(data);
 
     std::vector<vtkSmartPointer<vtkPolyData> >meshes;
@@ -195,6 +209,16 @@ int main(int argc, char **argv)
     // plan paths for segmented meshes
     tool_path_planner::ProcessTool tool = loadTool(pnh);
     tool_path_planner::RasterToolPathPlanner planner(tool.use_ransac_normal_estimation);
+    bool use_barycentric_normals;
+    pnh.param<bool>("use_barycentric_normal_estimation", use_barycentric_normals, false);
+    if(use_barycentric_normals)
+    {
+      planner.setNormalEstimation(tool_path_planner::RasterToolPathPlanner::BARYCENTRIC);
+    }
+    int max_rasters;
+    pnh.param<int>("max_rasters", max_rasters, 10);
+    planner.setMaxRasters(max_rasters);
+    planner.setShareInputMesh(true);  // the meshes are not changed while planning, no need to copy them
 
     bool debug_on;
     pnh.param<bool>("debug_on", debug_on, false);
@@ -211,9 +235,39 @@ int main(int argc, char **argv)
     planner.setCutDirection(vect);
     planner.setCutCentroid(center);
     planner.setDebugMode(debug_on);
+    bool debug_recording;
+    pnh.param<bool>("debug_recording", debug_recording, false);
+    planner.setDebugRecording(debug_recording);
     planner.setLogDir(log_directory);
     std::vector< std::vector<tool_path_planner::ProcessPath> > paths;
+    bool collect_stats;
+    pnh.param<bool>("collect_stats", collect_stats, false);
+    planner.setCollectStats(collect_stats);
     planner.planPaths(meshes, paths);
+    if(collect_stats)
+    {
+      tool_path_planner::PlannerStats stats = planner.getStats();
+      ROS_INFO("planning took %.3f s: setup %.3f s, intersection %.3f s (%ld), smoothing %.3f s, normals %.3f s (%ld kd "
+               "tree queries, %ld ransac failures), holes %.3f s, self intersection %.3f s (%ld), %ld points, %ld bytes "
+               "peak scratch memory",
+               stats.total_time, stats.setup_time, stats.intersection_time, stats.intersections, stats.smoothing_time,
+               stats.normal_estimation_time, stats.kd_tree_queries, stats.ransac_failures, stats.hole_check_time,
+               stats.self_intersection_time, stats.self_intersection_checks, stats.points, stats.peak_scratch_bytes);
+    }
+
+    // the display blocks until it is closed, write the trace first
+    if(!trace_file.empty())
+    {
+      vtk_viewer::Trace::stop();
+      if(vtk_viewer::Trace::write(trace_file))
+      {
+        ROS_INFO_STREAM("trace written to " << trace_file);
+      }
+      else
+      {
+        ROS_ERROR_STREAM("could not write trace to " << trace_file);
+      }
+    }
 
     // visualize results
     double scale = tool.pt_spacing * 1.5;
@@ -0,0 +1,351 @@
+/*
+ * Copyright (c) 2016, Southwest Research Institute
+ * All rights reserved.
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <gtest/gtest.h>
+
+#include <mesh_segmenter/mesh_segmenter.h>
+#include <path_sequence_planner/simple_path_sequence_planner.h>
+#include <tool_path_planner/raster_tool_path_planner.h>
+#include <vtk_viewer/mesh_generator.h>
+#include <vtk_viewer/vtk_utils.h>
+
+namespace
+{
+  const char* STAGES[] = {"segmentation", "planning", "sequencing"};  /**< The stages of the pipeline, in order */
+
+  struct StageResult
+  {
+    double time; // wall time of the stage (the fastest repetition), seconds
+    long peak_rss_kb; // peak resident set size during the stage (the largest repetition), kB
+    long points; // number of points output by the stage
+  };
+
+  /**
+   * @brief readPeakRss Reads the peak resident set size of the process (VmHWM) from /proc/self/status
+   * @return The peak in kB, 0 if it is not available
+   */
+  long readPeakRss()
+  {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while(std::getline(status, line))
+    {
+      if(line.compare(0, 6, "VmHWM:") == 0)
+      {
+        return std::atol(line.c_str() + 6);
+      }
+    }
+    return 0;
+  }
+
+  /**
+   * @brief resetPeakRss Resets the peak resident set size of the process to the current resident set size, so the
+   * next readPeakRss() gives the peak of the stage which follows instead of the peak of the whole test
+   */
+  void resetPeakRss()
+  {
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+  }
+
+  /**
+   * @brief The StageMeter class measures the wall time and peak memory of a stage, from its construction to stop()
+   */
+  class StageMeter
+  {
+  public:
+    StageMeter()
+    {
+      resetPeakRss();
+      start_ = std::chrono::steady_clock::now();
+    }
+
+    /**
+     * @brief stop Ends the measurement and merges it with the previous repetitions of the stage
+     * @param points The number of points output by the stage
+     * @param result [in/out] The result of the stage, the time is the fastest and the memory the largest repetition
+     * @param first True for the first repetition, to initialize the result
+     */
+    void stop(long points, StageResult& result, bool first)
+    {
+      double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+      long peak_rss_kb = readPeakRss();
+      result.time = first ? time : std::min(result.time, time);
+      result.peak_rss_kb = first ? peak_rss_kb : std::max(result.peak_rss_kb, peak_rss_kb);
+      result.points = points;
+    }
+
+  private:
+    std::chrono::steady_clock::time_point start_;  /**< Start of the stage */
+  };
+
+  /**
+   * @brief loadMesh Loads the mesh of a corpus entry, either a recorded STL/PLY file or a generated surface
+   * @param entry The corpus entry
+   * @param dir The directory of the baseline file, recorded files are relative to it
+   * @return The mesh with normals, NULL if it could not be loaded
+   */
+  vtkSmartPointer<vtkPolyData> loadMesh(const boost::property_tree::ptree& entry, const boost::filesystem::path& dir)
+  {
+    vtkSmartPointer<vtkPolyData> mesh;
+    std::string file = entry.get<std::string>("file", "");
+    if(!file.empty())
+    {
+      boost::filesystem::path path = dir / file;
+      std::string extension = path.extension().string();
+      std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+      if(extension == ".stl")
+      {
+        mesh = vtk_viewer::readSTLFile(path.string());
+      }
+      else if(extension == ".ply")
+      {
+        pcl::PolygonMesh pcl_mesh;
+        if(vtk_viewer::loadPolygonMeshFromPLY(path.string(), pcl_mesh))
+        {
+          mesh = vtkSmartPointer<vtkPolyData>::New();
+          vtk_viewer::pclEncodeMeshAndNormals(pcl_mesh, mesh);
+        }
+      }
+    }
+    else
+    {
+      std::string surface = entry.get<std::string>("surface", "sinusoidal");
+      vtk_viewer::SurfaceType type = vtk_viewer::SINUSOIDAL_SURFACE;
+      if(surface == "cylindrical")
+      {
+        type = vtk_viewer::CYLINDRICAL_SURFACE;
+      }
+      else if(surface == "freeform")
+      {
+        type = vtk_viewer::FREEFORM_SURFACE;
+      }
+      mesh = vtk_viewer::createSurfaceMesh(type, entry.get<long>("triangles", 10000), entry.get<double>("size", 1.0),
+                                           entry.get<int>("holes", 0), entry.get<double>("noise", 0.0),
+                                           entry.get<unsigned int>("seed", 0));
+    }
+
+    if(mesh && mesh->GetNumberOfCells() > 0)
+    {
+      vtk_viewer::generateNormals(mesh);
+      return mesh;
+    }
+    return NULL;
+  }
+
+  /**
+   * @brief countPoints Counts the points of the paths
+   * @param paths The paths
+   * @return The number of points
+   */
+  long countPoints(const std::vector<tool_path_planner::ProcessPath>& paths)
+  {
+    long points = 0;
+    for(int i = 0; i < paths.size(); ++i)
+    {
+      points += paths[i].line ? paths[i].line->GetNumberOfPoints() : 0;
+    }
+    return points;
+  }
+
+  /**
+   * @brief runPipeline Segments the mesh, plans the paths of every segment and sequences them, measuring each stage
+   * @param mesh The mesh
+   * @param tool The tool used for planning
+   * @param repetitions The number of times the pipeline is run
+   * @param results [output] The result of each stage, in the order of STAGES
+   */
+  void runPipeline(vtkSmartPointer<vtkPolyData> mesh, const tool_path_planner::ProcessTool& tool, int repetitions,
+                   StageResult* results)
+  {
+    for(int r = 0; r < repetitions; ++r)
+    {
+      std::unique_ptr<StageMeter> meter(new StageMeter);
+      mesh_segmenter::MeshSegmenter segmenter;
+      segmenter.setInputMesh(mesh);
+      segmenter.segmentMesh();
+      std::vector<vtkSmartPointer<vtkPolyData> > segments = segmenter.getMeshSegments();
+      long points = 0;
+      for(int i = 0; i < segments.size(); ++i)
+      {
+        points += segments[i]->GetNumberOfPoints();
+      }
+      meter->stop(points, results[0], r == 0);
+
+      meter.reset(new StageMeter);
+      tool_path_planner::RasterToolPathPlanner planner;
+      planner.setTool(tool);
+      planner.setMaxRasters(0);
+      std::vector<std::vector<tool_path_planner::ProcessPath> > paths;
+      planner.planPaths(segments, paths);
+      points = 0;
+      for(int i = 0; i < paths.size(); ++i)
+      {
+        points += countPoints(paths[i]);
+      }
+      meter->stop(points, results[1], r == 0);
+
+      // the sequence planner needs at least two paths to link
+      meter.reset(new StageMeter);
+      points = 0;
+      for(int i = 0; i < paths.size(); ++i)
+      {
+        if(paths[i].size() < 2)
+        {
+          points += countPoints(paths[i]);
+          continue;
+        }
+        path_sequence_planner::SimplePathSequencePlanner sequencer;
+        sequencer.setPaths(paths[i]);
+        sequencer.linkPaths();
+        points += countPoints(sequencer.getPaths());
+      }
+      meter->stop(points, results[2], r == 0);
+    }
+  }
+
+  /**
+   * @brief exceeds Checks whether a measurement is worse than its baseline by more than the tolerance
+   * @param value The measurement
+   * @param baseline The baseline
+   * @param ratio The allowed relative increase
+   * @param slack The allowed absolute increase, so very small baselines do not fail on noise
+   * @return True if the measurement regressed
+   */
+  bool exceeds(double value, double baseline, double ratio, double slack)
+  {
+    return value > baseline + std::max(baseline * ratio, slack);
+  }
+}
+
+// This test replays the corpus of the baseline file through segmentation, planning and sequencing and fails when a
+// stage outputs a different number of points than its baseline allows.  Set NOETHER_REGRESSION_PERF=1 to also fail
+// when a stage is slower or uses more memory than its baseline, which must then be recorded on the same machine.  Set
+// NOETHER_REGRESSION_BASELINE to use another baseline file and NOETHER_REGRESSION_UPDATE=1 to record the results of
+// this machine as the new baseline instead of checking them.
+
+TEST(RegressionTest, TestCaseBaseline)
+{
+  const char* env_file = std::getenv("NOETHER_REGRESSION_BASELINE");
+  const char* env_update = std::getenv("NOETHER_REGRESSION_UPDATE");
+  const char* env_perf = std::getenv("NOETHER_REGRESSION_PERF");
+  boost::filesystem::path file = env_file ? env_file : REGRESSION_BASELINE;
+  bool update = env_update && std::string(env_update) == "1";
+  bool perf = env_perf && std::string(env_perf) == "1";
+
+  boost::property_tree::ptree baseline;
+  boost::property_tree::read_json(file.string(), baseline);
+
+  double time_ratio = baseline.get<double>("tolerance.time", 0.25);
+  double time_slack = baseline.get<double>("tolerance.min_time", 0.05);
+  double rss_ratio = baseline.get<double>("tolerance.rss", 0.25);
+  double rss_slack = baseline.get<double>("tolerance.min_rss_kb", 16384);
+  double points_ratio = baseline.get<double>("tolerance.points", 0.01);
+  int repetitions = std::max(1, baseline.get<int>("repetitions", 3));
+
+  tool_path_planner::ProcessTool tool;
+  tool.pt_spacing = baseline.get<double>("tool.pt_spacing", 0.01);
+  tool.line_spacing = baseline.get<double>("tool.line_spacing", 0.05);
+  tool.tool_offset = 0.0; // currently unused
+  tool.intersecting_plane_height = baseline.get<double>("tool.intersecting_plane_height", 0.05);
+  tool.nearest_neighbors = baseline.get<int>("tool.nearest_neighbors", 30);
+  tool.min_hole_size = baseline.get<double>("tool.min_hole_size", 0.05);
+  tool.use_ransac_normal_estimation = baseline.get<bool>("tool.use_ransac_normal_estimation", false);
+  tool.plane_fit_threhold = baseline.get<double>("tool.plane_fit_threshold", 0.01);
+  tool.min_segment_size = baseline.get<double>("tool.min_segment_size", 0.01);
+
+  for(boost::property_tree::ptree::value_type& item : baseline.get_child("meshes"))
+  {
+    boost::property_tree::ptree& entry = item.second;
+    std::string name = entry.get<std::string>("name");
+    vtkSmartPointer<vtkPolyData> mesh = loadMesh(entry, file.parent_path());
+    ASSERT_TRUE(mesh) << "could not load mesh " << name;
+
+    StageResult results[3];
+    runPipeline(mesh, tool, repetitions, results);
+
+    int checked = 0;
+    for(int i = 0; i < 3; ++i)
+    {
+      const StageResult& result = results[i];
+      std::string stage = std::string("stages.") + STAGES[i];
+      std::cout << name << " " << STAGES[i] << ": " << result.time << " s, " << result.peak_rss_kb << " kB peak, "
+                << result.points << " points" << std::endl;
+
+      if(update)
+      {
+        entry.put(stage + ".time", result.time);
+        entry.put(stage + ".peak_rss_kb", result.peak_rss_kb);
+        entry.put(stage + ".points", result.points);
+        continue;
+      }
+
+      // the number of points does not depend on the machine and is always checked when it is recorded
+      boost::optional<long> points = entry.get_optional<long>(stage + ".points");
+      if(points)
+      {
+        ++checked;
+        EXPECT_LE(std::abs(result.points - *points), points_ratio * *points)
+            << name << " " << STAGES[i] << " output " << result.points << " points, baseline " << *points;
+      }
+      else
+      {
+        std::cout << name << " " << STAGES[i] << ": no points baseline, run with NOETHER_REGRESSION_UPDATE=1 to "
+                  << "record one" << std::endl;
+      }
+
+      // time and memory depend on the machine, they are only checked on request against a baseline recorded there
+      if(!perf)
+      {
+        continue;
+      }
+      boost::optional<double> time = entry.get_optional<double>(stage + ".time");
+      boost::optional<long> peak_rss_kb = entry.get_optional<long>(stage + ".peak_rss_kb");
+      if(!time || !peak_rss_kb)
+      {
+        ADD_FAILURE() << name << " " << STAGES[i] << " has no time or memory baseline, run with "
+                      << "NOETHER_REGRESSION_UPDATE=1 on this machine to record one";
+        continue;
+      }
+      EXPECT_FALSE(exceeds(result.time, *time, time_ratio, time_slack))
+          << name << " " << STAGES[i] << " took " << result.time << " s, baseline " << *time << " s";
+      EXPECT_FALSE(exceeds(result.peak_rss_kb, *peak_rss_kb, rss_ratio, rss_slack))
+          << name << " " << STAGES[i] << " peak memory " << result.peak_rss_kb << " kB, baseline " << *peak_rss_kb
+          << " kB";
+    }
+
+    // an entry without any recorded points would pass whatever the pipeline does
+    if(!update && checked == 0)
+    {
+      ADD_FAILURE() << name << " has no points baseline for any stage";
+    }
+  }
+
+  if(update)
+  {
+    boost::property_tree::write_json(file.string(), baseline);
+    std::cout << "baseline written to " << file.string() << std::endl;
+  }
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -6,11 +6,14 @@
 #include <ros/time.h>
 #include <vtkPointData.h>
 #include <eigen_conversions/eigen_msg.h>
+#include <vtk_viewer/trace.h>
 
 
 std::vector<geometry_msgs::PoseArray> noether::convertVTKtoGeometryMsgs(
     const std::vector<tool_path_planner::ProcessPath>& paths)
 {
+  vtk_viewer::TraceSpan span("convertVTKtoGeometryMsgs");
+
   std::vector<geometry_msgs::PoseArray> poseArrayVector;
   for(int j = 0; j < paths.size(); ++j)
   {
@@ -7,12 +7,15 @@
 #include <algorithm>
 #include <path_sequence_planner/simple_path_sequence_planner.h>
 #include <vtk_viewer/vtk_utils.h>
+#include <vtk_viewer/trace.h>
 
 namespace path_sequence_planner
 {
 
 void SimplePathSequencePlanner::linkPaths()
 {
+  vtk_viewer::TraceSpan span("SimplePathSequencePlanner::linkPaths");
+
   bool insert_front = false;
   int last_index = 0;
 
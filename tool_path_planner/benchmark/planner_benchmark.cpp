@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2016, Southwest Research Institute
+ * All rights reserved.
+ *
+ */
+
+#include <chrono>
+
+#include <benchmark/benchmark.h>
+
+#include <tool_path_planner/raster_tool_path_planner.h>
+#include <vtk_viewer/mesh_generator.h>
+
+namespace
+{
+  const int HOLES = 3;  /**< Number of holes cut in the meshes with holes */
+
+  /**
+   * @brief BM_PlanPaths Plans the rasters of a generated sinusoidal mesh
+   * Arguments: number of triangles, 1 for holes in the mesh, normal estimation method
+   */
+  void BM_PlanPaths(benchmark::State& state)
+  {
+    vtkSmartPointer<vtkPolyData> mesh = vtk_viewer::createSurfaceMesh(vtk_viewer::SINUSOIDAL_SURFACE, state.range(0), 1.0,
+                                                                      state.range(1) ? HOLES : 0);
+
+    tool_path_planner::ProcessTool tool;
+    tool.pt_spacing = 0.01;
+    tool.line_spacing = 0.05;
+    tool.tool_offset = 0.0; // currently unused
+    tool.intersecting_plane_height = 0.05;
+    tool.nearest_neighbors = 30;
+    tool.min_hole_size = 0.05;
+    tool.use_ransac_normal_estimation = false;
+    tool.plane_fit_threhold = .01;
+    tool.min_segment_size = 0.01;
+
+    tool_path_planner::RasterToolPathPlanner planner;
+    planner.setTool(tool);
+    planner.setMaxRasters(0);
+    planner.setNormalEstimation(tool_path_planner::RasterToolPathPlanner::NormalEstimation(state.range(2)));
+
+    double seconds = 0.0;
+    long rasters = 0;
+    for(auto _ : state)
+    {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      std::vector<tool_path_planner::CompactPath> paths;
+      planner.planPaths(mesh, paths);
+      seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      rasters += paths.size();
+    }
+
+    long triangles = mesh->GetNumberOfPolys();
+    state.counters["mesh_triangles"] = triangles;
+    state.counters["rasters"] = double(rasters) / state.iterations();
+    state.counters["ms_per_raster"] = rasters > 0 ? 1e3 * seconds / rasters : 0.0;
+    state.counters["ns_per_triangle"] = 1e9 * seconds / (double(state.iterations()) * triangles);
+  }
+
+  /**
+   * @brief plannerArguments Adds every combination of mesh size, holes and normal estimation method
+   * @param bench The benchmark
+   */
+  void plannerArguments(benchmark::internal::Benchmark* bench)
+  {
+    const long sizes[] = {1000, 10000, 100000, 1000000, 5000000};
+    const int methods[] = {tool_path_planner::RasterToolPathPlanner::NEAREST_NEIGHBORS,
+                           tool_path_planner::RasterToolPathPlanner::RANSAC};
+    for(int i = 0; i < 5; ++i)
+    {
+      for(int holes = 0; holes < 2; ++holes)
+      {
+        for(int j = 0; j < 2; ++j)
+        {
+          bench->Args({sizes[i], holes, methods[j]});
+        }
+      }
+    }
+  }
+}
+
+BENCHMARK(BM_PlanPaths)->Apply(plannerArguments)->ArgNames({"triangles", "holes", "normals"})
+                        ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
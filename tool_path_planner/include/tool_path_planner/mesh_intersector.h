@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2016, Southwest Research Institute
+ * All rights reserved.
+ *
+ */
+
+#ifndef MESH_INTERSECTOR_H
+#define MESH_INTERSECTOR_H
+
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+
+namespace tool_path_planner
+{
+  /**
+   * @brief Name of the cell data array which stores, for every intersection segment, the id of the mesh cell it lies on
+   */
+  const char* const MESH_CELL_IDS = "MeshCellIds";
+
+  /**
+   * @brief The MeshIntersector class finds the intersection of triangulated surfaces (e.g. raster cutting surfaces) with
+   * a mesh.  A bounding volume hierarchy over the mesh triangles is built once by setInputMesh() and reused by every
+   * query, so the cost of a query scales with the number of mesh triangles near the surface, not with the mesh size.
+   * Queries only read the tree and the mesh and may be run from several threads at once.
+   */
+  class MeshIntersector
+  {
+  public:
+
+    MeshIntersector(){}
+
+    /**
+     * @brief setInputMesh Sets the mesh to intersect with and builds the bounding volume hierarchy over its polygons
+     * @param mesh The mesh, it is referenced (not copied) and must not be modified while the intersector is in use
+     */
+    void setInputMesh(vtkSmartPointer<vtkPolyData> mesh);
+
+    /**
+     * @brief getInputMesh Gets the mesh used for intersections
+     * @return The mesh
+     */
+    vtkSmartPointer<vtkPolyData> getInputMesh() const {return mesh_;}
+
+    /**
+     * @brief intersect Finds the intersection of a surface with the mesh
+     * @param surface The surface to intersect with the mesh (polygons are triangulated as fans)
+     * @param lines The intersection as 2 point line cells, adjacent segments share their end point.  The id of the mesh
+     * cell each segment lies on is stored in the MESH_CELL_IDS cell data array.
+     * @return True if at least one intersection segment was found
+     */
+    bool intersect(vtkSmartPointer<vtkPolyData> surface, vtkSmartPointer<vtkPolyData>& lines) const;
+
+    /**
+     * @brief intersects Checks if a surface intersects the mesh, stops at the first intersection found
+     * @param surface The surface to check
+     * @return True if the surface intersects the mesh
+     */
+    bool intersects(vtkSmartPointer<vtkPolyData> surface) const;
+
+    /**
+     * @brief slice Intersects the mesh with a set of evenly spaced parallel planes in a single pass.  Each mesh triangle
+     * is visited once and emits its segments for every plane its extent along the normal spans, so the cost is linear in
+     * the number of triangles plus the size of the output instead of the number of planes times the mesh size.
+     * @param normal The unit normal of the planes
+     * @param offset The signed distance of the first plane from the origin along the normal
+     * @param spacing The distance between neighboring planes
+     * @param num_planes The number of planes
+     * @param lines The intersection with each plane, in the same format as intersect() (empty if a plane misses the mesh)
+     */
+    void slice(const double normal[3], double offset, double spacing, int num_planes,
+               std::vector<vtkSmartPointer<vtkPolyData> >& lines) const;
+
+  private:
+
+    /**
+     * @brief A node of the bounding volume hierarchy, nodes are stored depth first so the left child of a node is the
+     * next node in the list
+     */
+    struct Node
+    {
+      double min[3];  /**< Minimum corner of the node bounding box */
+      double max[3];  /**< Maximum corner of the node bounding box */
+      int start;  /**< Index of the first triangle (leaf nodes) */
+      int count;  /**< Number of triangles, 0 for inner nodes */
+      int right;  /**< Index of the right child (inner nodes) */
+    };
+
+    /**
+     * @brief A triangle of the mesh, coordinates are read from the mesh points when needed
+     */
+    struct MeshTriangle
+    {
+      vtkIdType ids[3];  /**< Point ids of the corners */
+      vtkIdType cell;  /**< Id of the mesh cell the triangle belongs to */
+    };
+
+    /**
+     * @brief A triangle with its coordinates, the point ids are used to identify shared edges
+     */
+    struct Triangle
+    {
+      vtkIdType ids[3];  /**< Point ids of the corners */
+      double pts[3][3];  /**< Corner coordinates */
+      vtkIdType cell;  /**< Id of the mesh cell (mesh triangles) or triangle index (query surface triangles) */
+      vtkIdType index;  /**< Index of the triangle, used to identify it in the segment end point keys */
+    };
+
+    /**
+     * @brief Identifies an end point of an intersection segment: the crossing of an edge of one triangle with the other
+     * triangle (or with a slicing plane).  Segments computed from neighboring triangles produce the same key for their
+     * shared end point.
+     */
+    struct PointKey
+    {
+      int type;  /**< 0: mesh edge crossing a surface triangle or plane, 1: surface edge crossing a mesh triangle */
+      vtkIdType edge[2];  /**< Sorted point ids of the edge, the same id twice if the crossing is at a corner */
+      vtkIdType triangle;  /**< The triangle (or plane index) crossed by the edge */
+      bool operator<(const PointKey& other) const;
+    };
+
+    /**
+     * @brief An intersection segment between a mesh triangle and a surface triangle
+     */
+    struct Segment
+    {
+      PointKey keys[2];  /**< Keys of the end points */
+      double pts[2][3];  /**< End point coordinates */
+      vtkIdType cell;  /**< Id of the mesh cell the segment lies on */
+    };
+
+    /**
+     * @brief buildNode Recursively builds the hierarchy over triangles_[start, start + count)
+     * @param start The first triangle of the node
+     * @param count The number of triangles in the node
+     * @param centroids The triangle centroids, reordered together with the triangles
+     * @return The index of the new node
+     */
+    int buildNode(int start, int count, std::vector<double>& centroids);
+
+    /**
+     * @brief getSurfaceTriangles Triangulates the polygons of a query surface
+     * @param surface The surface
+     * @param triangles The triangles, cell and index are set to the triangle index
+     */
+    static void getSurfaceTriangles(vtkSmartPointer<vtkPolyData> surface, std::vector<Triangle>& triangles);
+
+    /**
+     * @brief query Finds intersection segments between the surface triangles and the mesh
+     * @param triangles The surface triangles
+     * @param segments The segments found
+     * @param first_only If true, stops after the first segment
+     */
+    void query(const std::vector<Triangle>& triangles, std::vector<Segment>& segments, bool first_only) const;
+
+    /**
+     * @brief createLines Converts segments into line cells, end points with the same key are merged
+     * @param segments The segments
+     * @param lines The line cells with the MESH_CELL_IDS cell data array
+     */
+    static void createLines(const std::vector<Segment>& segments, vtkSmartPointer<vtkPolyData>& lines);
+
+    /**
+     * @brief intersectTriangles Computes the intersection segment of a mesh triangle and a surface triangle
+     * @param mesh_tri The mesh triangle
+     * @param surface_tri The surface triangle
+     * @param segment The intersection segment
+     * @return True if the triangles intersect in a segment of non zero length
+     */
+    static bool intersectTriangles(const Triangle& mesh_tri, const Triangle& surface_tri, Segment& segment);
+
+    vtkSmartPointer<vtkPolyData> mesh_;  /**< The mesh to intersect with */
+    std::vector<MeshTriangle> triangles_;  /**< The mesh triangles, in tree order */
+    std::vector<Node> nodes_;  /**< The bounding volume hierarchy, the root is the first node */
+  };
+
+}
+
+#endif // MESH_INTERSECTOR_H
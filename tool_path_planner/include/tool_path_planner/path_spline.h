@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2016, Southwest Research Institute
+ * All rights reserved.
+ *
+ */
+
+#ifndef PATH_SPLINE_H
+#define PATH_SPLINE_H
+
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkPoints.h>
+
+namespace tool_path_planner
+{
+  /**
+   * @brief The PathSpline class is a natural cubic spline through a sequence of points, parameterized by the chord
+   * length between the points (the same parameter vtkParametricSpline uses, but not normalized to [0, 1]).  A table of
+   * the arc length at the knots and at a few points inside every segment is computed once, so points can be placed at
+   * exact arc length positions and their tangents are computed from the polynomials instead of finite differences.
+   */
+  class PathSpline
+  {
+  public:
+
+    PathSpline(){}
+
+    /**
+     * @brief setPoints Fits the spline through a sequence of points and computes its arc length table
+     * @param points The points, consecutive duplicates are ignored
+     * @return False if the points do not span a curve of non zero length
+     */
+    bool setPoints(vtkSmartPointer<vtkPoints> points);
+
+    /**
+     * @brief getLength Gets the arc length of the spline
+     * @return The arc length, 0 if no curve is set
+     */
+    double getLength() const {return lengths_.empty() ? 0.0 : lengths_.back();}
+
+    /**
+     * @brief getParameterLength Gets the chord length of the input points, the range of the spline parameter
+     * @return The chord length
+     */
+    double getParameterLength() const {return knots_.empty() ? 0.0 : knots_.back();}
+
+    /**
+     * @brief evaluate Evaluates the spline at a parameter value
+     * @param t The parameter (chord length from the first point), clamped to [0, getParameterLength()]
+     * @param pt The point on the spline
+     * @param tangent The unit tangent in the direction of increasing parameter, may be NULL
+     */
+    void evaluate(double t, double pt[3], double tangent[3]) const;
+
+    /**
+     * @brief resample Places points evenly along the spline, including both end points
+     * @param spacing The desired distance along the curve between neighboring points, the actual spacing is adjusted
+     * so the points divide the curve into equal parts
+     * @param points The points, 3 values per point
+     * @param tangents The unit tangents at the points in the direction of the curve, 3 values per point
+     * @param params The spline parameter of each point
+     */
+    void resample(double spacing, std::vector<double>& points, std::vector<double>& tangents,
+                  std::vector<double>& params) const;
+
+  private:
+
+    /**
+     * @brief findSegment Finds the segment of the spline which contains a parameter value
+     * @param t The parameter
+     * @return The index of the segment
+     */
+    int findSegment(double t) const;
+
+    /**
+     * @brief speed Computes the norm of the derivative of a segment
+     * @param segment The segment
+     * @param u The parameter relative to the start of the segment
+     * @return The speed
+     */
+    double speed(int segment, double u) const;
+
+    /**
+     * @brief segmentLength Integrates the speed of a segment over an interval of its parameter
+     * @param segment The segment
+     * @param u0 The start of the interval, relative to the start of the segment
+     * @param u1 The end of the interval, relative to the start of the segment
+     * @return The arc length of the interval
+     */
+    double segmentLength(int segment, double u0, double u1) const;
+
+    /**
+     * @brief findParameter Finds the parameter at which the spline reaches an arc length
+     * @param length The arc length from the start of the spline
+     * @param start The entry of the arc length table to start searching from, updated to the entry used so increasing
+     * lengths can be looked up in one pass over the table
+     * @return The parameter
+     */
+    double findParameter(double length, int& start) const;
+
+    std::vector<double> knots_;  /**< Parameter value at every input point */
+    std::vector<double> coeffs_;  /**< Polynomial coefficients, 12 per segment: (a, b, c, d) for x, y and z */
+    std::vector<double> lengths_;  /**< Arc length at the start of every sub interval of the segments and at the end */
+  };
+
+}
+
+#endif // PATH_SPLINE_H
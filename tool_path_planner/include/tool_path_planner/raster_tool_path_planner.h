@@ -7,17 +7,57 @@
 #ifndef RASTER_TOOL_PATH_PLANNER_H
 #define RASTER_TOOL_PATH_PLANNER_H
 
+#include <deque>
+#include <memory>
+#include <mutex>
+
 #include <vtkPoints.h>
 #include <vtkKdTreePointLocator.h>
+#include <vtkIdTypeArray.h>
+
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+#include <vtk_viewer/cell_adjacency.h>
+#include <vtk_viewer/debug_recorder.h>
+#include <vtk_viewer/thread_pool.h>
 
 #include <tool_path_planner/tool_path_planner.h>
+#include <tool_path_planner/mesh_intersector.h>
 
 namespace tool_path_planner
 {
+  struct PlannerStats
+  {
+    double total_time;  /**< Wall time of setInputMesh() and computePaths() (the whole planPaths() call), seconds */
+    double setup_time;  /**< Copying the input mesh, generating its normals and building the kd tree, intersector and cell adjacency */
+    double intersection_time;  /**< Intersecting cutting surfaces (or slicing planes) with the mesh */
+    double smoothing_time;  /**< Fitting splines through the intersections and resampling them */
+    double normal_estimation_time;  /**< Estimating the normals of path and offset points */
+    double hole_check_time;  /**< Finding the holes the rasters cross */
+    double self_intersection_time;  /**< Checking new cutting surfaces against the existing ones */
+    long intersections;  /**< Number of intersection filter invocations (a slice of several planes counts once per plane) */
+    long self_intersection_checks;  /**< Number of cutting surface pairs checked for intersection */
+    long kd_tree_queries;  /**< Number of nearest neighbor queries */
+    long ransac_failures;  /**< Number of points ransac found no plane for, their normals are left zero */
+    long points;  /**< Number of path points generated (including the points of paths which are split or discarded later) */
+    long peak_scratch_bytes;  /**< Largest temporary memory of one step (intersection, spline samples, ransac buffers), estimated */
+  };
+
   class RasterToolPathPlanner : public ToolPathPlanner
   {
   public:
 
+    /**
+     * @brief Methods used to estimate the normals of the path points from the input mesh
+     */
+    enum NormalEstimation
+    {
+      NEAREST_NEIGHBORS,  /**< average the normals of the nearest mesh vertices */
+      RANSAC,  /**< fit a plane to the nearest mesh vertices */
+      BARYCENTRIC  /**< interpolate the vertex normals of the mesh cell the path crosses */
+    };
+
     /**
      * @brief constructor
      * @param use_ransac set flag to use ransac plane estimation to determine path normals
@@ -35,6 +75,13 @@ namespace tool_path_planner
     void planPaths(const std::vector<pcl::PolygonMesh>& meshes, std::vector< std::vector<ProcessPath> >& paths);
     void planPaths(const pcl::PolygonMesh& mesh, std::vector<ProcessPath>& paths);
 
+    /**
+     * @brief planPaths plans the paths for a mesh and returns them in compact form, no VTK data is created for the paths
+     * @param mesh The mesh to plan paths for
+     * @param paths The resulting paths
+     */
+    void planPaths(const vtkSmartPointer<vtkPolyData> mesh, std::vector<CompactPath>& paths);
+
     /**
      * @brief setInputMesh Sets the input mesh to generate paths
      * @param mesh The input mesh to be operated on
@@ -82,10 +129,16 @@ namespace tool_path_planner
     bool computePaths();
 
     /**
-     * @brief getPaths Gets all of the paths generated
+     * @brief getPaths Gets all of the paths generated, the VTK data of the paths is created by every call
      * @return The paths generated from the computePaths() function
      */
-    std::vector<ProcessPath> getPaths(){return paths_;}
+    std::vector<ProcessPath> getPaths();
+
+    /**
+     * @brief getCompactPaths Gets all of the paths generated in compact form
+     * @return The paths generated from the computePaths() function
+     */
+    std::vector<CompactPath> getCompactPaths();
 
     /**
      * @brief generateNormals For a set of new points, estimates the normal from the input mesh normals by averaging N nearest neighbors' normals
@@ -94,47 +147,236 @@ namespace tool_path_planner
     void estimateNewNormals(vtkSmartPointer<vtkPolyData>& data);
 
     /**
-     * @brief generateNormals For a set of new points, estimates the normal from the input mesh normals ransac plane fit
+     * @brief generateNormals For a set of new points, estimates the normal from the input mesh normals ransac plane fit,
+     * the points are spread over getNumThreads() threads
      * @param data The points to operate on, normal data inserted in place
      */
     void estimateNewNormalsRansac(vtkSmartPointer<vtkPolyData>& data);
 
     /**
-     * @brief setDebugModeOn Turn on debug mode to visualize every step of the path planning process
+     * @brief setNormalEstimation Set the method used to estimate the path normals.  BARYCENTRIC interpolates the vertex
+     * normals of the mesh cell each path point lies on, which is known from the intersection, so no nearest neighbor
+     * search is needed.  Points that are not on an intersection (e.g. offset curves) use NEAREST_NEIGHBORS instead.
+     * @param method The normal estimation method, NEAREST_NEIGHBORS (or RANSAC if set in the constructor) by default
+     */
+    void setNormalEstimation(NormalEstimation method){normal_estimation_ = method;}
+
+    /**
+     * @brief getNormalEstimation Get the method used to estimate the path normals
+     * @return The normal estimation method
+     */
+    NormalEstimation getNormalEstimation(){return normal_estimation_;}
+
+    /**
+     * @brief setDebugModeOn Turn on debug mode to visualize every step of the path planning process.  The debug viewer
+     * is only created once debug mode is used, debug mode is not available in headless builds
+     * (TOOL_PATH_PLANNER_HEADLESS).
      * @param debug Turns on debug if true, turns off debug if false
      */
-    void setDebugMode(bool debug){debug_on_ = debug;}
+    void setDebugMode(bool debug);
+
+    /**
+     * @brief setCollectStats Collect the timing and counters of the planning stages, see getStats().  Only a flag is
+     * checked at every stage while collection is off.
+     * @param collect Turns on collection if true, turns off collection if false
+     */
+    void setCollectStats(bool collect){collect_stats_ = collect;}
+
+    /**
+     * @brief getCollectStats Get whether planning statistics are collected
+     * @return True if statistics are collected
+     */
+    bool getCollectStats(){return collect_stats_;}
+
+    /**
+     * @brief getStats Get the planning statistics, reset by every setInputMesh() (so by every planPaths() call).  For a
+     * list of meshes the statistics of all meshes are added up (stage times are summed over the threads) and total_time
+     * is the wall time of the whole call.
+     * @return The statistics, all zero if collection is off
+     */
+    PlannerStats getStats(){return stats_;}
+
+    /**
+     * @brief setDebugRecording Record the intermediate data of every planning step (cutting surfaces, splines, paths
+     * with normals and derivatives) to numbered .vtp files in the log directory for offline replay.  The files are
+     * written by a background thread, so planning is not stalled, and recording also works in headless builds.
+     * Lists of meshes are planned serially while recording.
+     * @param record Turns on recording if true, turns off recording if false
+     */
+    void setDebugRecording(bool record);
+
+    /**
+     * @brief getDebugRecording Get whether the planning steps are recorded
+     * @return True if recording is on
+     */
+    bool getDebugRecording(){return record_on_;}
 
     /**
      * @brief setLogDir Set the directory for saving polydata files to
      * @param dir The directory to save data to
      */
-    void setLogDir(std::string dir){debug_viewer_.setLogDir(dir);}
+    void setLogDir(std::string dir);
 
     /**
      * @brief getLogDir Get the directory used for saving polydata files to
      * @return The directory currently used for saving data
      */
-    std::string getLogDir(){return debug_viewer_.getLogDir();}
+    std::string getLogDir(){return log_dir_;}
 
     void setCutDirection(double direction [3]);
     void setCutCentroid(double centroid [3]);
 
+    /**
+     * @brief setNumThreads Set the number of threads used when planning paths for a list of meshes; each mesh is
+     * planned by its own planner instance, results are returned in input order regardless of the number of threads.
+     * When planning a single mesh the threads are used by the ransac normal estimation and to build the cell adjacency
+     * of the mesh instead, their results do not depend on the number of threads either.  Debug mode always plans the meshes one after the other.
+     * The ransac threads are started on first use and kept until the number of threads changes.
+     * @param num_threads The number of threads to use, 1 (default) plans serially, 0 uses all hardware threads
+     */
+    void setNumThreads(int num_threads){num_threads_ = num_threads; ransac_pool_.reset();}
+
+    /**
+     * @brief getNumThreads Get the number of threads used when planning paths for a list of meshes
+     * @return The number of threads, 0 means all hardware threads
+     */
+    int getNumThreads(){return num_threads_;}
+
+    /**
+     * @brief setConcurrentSweeps Grow the rasters on both sides of the first path at the same time (one thread per
+     * direction).  On closed surfaces the two directions meet halfway instead of where the first one ended, the
+     * result is the same on every run.  Ignored in debug mode.
+     * @param concurrent Turns on the concurrent sweeps if true, sweeps one direction after the other if false
+     */
+    void setConcurrentSweeps(bool concurrent){concurrent_sweeps_ = concurrent;}
+
+    /**
+     * @brief getConcurrentSweeps Get whether both sweep directions are computed at the same time
+     * @return True if the sweeps run concurrently
+     */
+    bool getConcurrentSweeps(){return concurrent_sweeps_;}
+
+    /**
+     * @brief setStraightRasters Use straight rasters: every path is the intersection of the mesh with a plane, the planes
+     * are parallel and line_spacing apart.  All planes are sliced in a single pass over the mesh instead of growing the
+     * rasters one offset surface at a time, so the rasters do not follow the surface curvature.
+     * @param straight Turns on straight rasters if true, curvature following rasters if false
+     */
+    void setStraightRasters(bool straight){straight_rasters_ = straight;}
+
+    /**
+     * @brief getStraightRasters Get whether straight rasters are used
+     * @return True if straight rasters are used
+     */
+    bool getStraightRasters(){return straight_rasters_;}
+
+    /**
+     * @brief setMaxRasters Set the maximum number of rasters computePaths() grows on each side of the first path
+     * (curvature following rasters only)
+     * @param max The maximum number of rasters per side, 10 by default.  0 removes the limit, the sweeps then end when a
+     * raster misses the mesh or meets an existing raster (bounded by the mesh extent as a safety net).
+     */
+    void setMaxRasters(int max){max_rasters_ = max;}
+
+    /**
+     * @brief getMaxRasters Get the maximum number of rasters grown on each side of the first path
+     * @return The maximum number of rasters per side, 0 if unlimited
+     */
+    int getMaxRasters(){return max_rasters_;}
+
+    /**
+     * @brief setShareInputMesh Reference the points, cells and point data of the mesh given to setInputMesh() (and
+     * planPaths()) instead of copying them.  The planner keeps its own normals, cell table and locators, the mesh is
+     * never modified but must not be changed by the caller while the planner uses it.
+     * @param share Shares the input mesh if true, copies it if false (default)
+     */
+    void setShareInputMesh(bool share){share_input_mesh_ = share;}
+
+    /**
+     * @brief getShareInputMesh Get whether the input mesh is shared instead of copied
+     * @return True if the input mesh is shared
+     */
+    bool getShareInputMesh(){return share_input_mesh_;}
+
   private:
 
-    bool use_ransac_normal_estimation_;
+    /**
+     * @brief A path as it is stored while planning: the path points in compact form and the VTK data needed to grow
+     * the next raster from it (the VTK line, derivatives and spline are only created for getPaths())
+     */
+    struct Raster
+    {
+      CompactPath path;  /**< The path points, normals and derivatives */
+      vtkSmartPointer<vtkPolyData> intersection_plane;  /**< The cutting surface through the path */
+      vtkSmartPointer<vtkPolyData> intersection;  /**< The intersection of the cutting surface with the mesh */
+    };
+
+    /**
+     * @brief Buffers reused by a thread for every point of the ransac normal estimation
+     */
+    struct RansacScratch
+    {
+      vtkSmartPointer<vtkIdList> result;  /**< Ids of the nearest mesh vertices */
+      pcl::PointCloud<pcl::PointXYZ>::Ptr cloud;  /**< The nearest mesh vertices */
+      std::vector<int> inliers;  /**< Inliers of the fitted plane */
+      long failures;  /**< Number of points no plane was found for in the current call */
+    };
+
+    NormalEstimation normal_estimation_;  /**< Method used to estimate the path normals */
+    int num_threads_;  /**< Number of threads used to plan multiple meshes at once */
+    bool concurrent_sweeps_;  /**< Computes the two sweep directions of computePaths() in parallel */
+    bool straight_rasters_;  /**< Slices the mesh with parallel planes instead of growing curved rasters */
+    int max_rasters_;  /**< Maximum number of rasters grown on each side of the first path, 0 for no limit */
+    bool share_input_mesh_;  /**< References the geometry of the input mesh instead of copying it */
 
 
     bool debug_on_;  /**< Turns on/off the debug display which views the path planning output one step at a time */
-    vtk_viewer::VTKViewer debug_viewer_;  /**< The vtk viewer for displaying debug output */
+    std::unique_ptr<vtk_viewer::VTKViewer> debug_viewer_;  /**< The vtk viewer for displaying debug output, created on first use */
+    bool record_on_;  /**< Records the planning steps with debug_recorder_ */
+    bool collect_stats_;  /**< Collects the planning statistics in stats_ */
+    PlannerStats stats_;  /**< Statistics since the last setInputMesh() */
+    std::mutex stats_mutex_;  /**< Protects stats_ while the sweeps or ransac threads update it */
+    std::unique_ptr<vtk_viewer::DebugRecorder> debug_recorder_;  /**< Writes the recorded planning steps in the background */
+    std::string log_dir_;  /**< The directory the debug viewer and recorder save polydata files to */
     vtkSmartPointer<vtkKdTreePointLocator> kd_tree_; /**< kd tree for finding nearest neighbor points */
+    std::unique_ptr<vtk_viewer::ThreadPool> ransac_pool_;  /**< Threads of the ransac normal estimation, created on first use */
+    std::vector<RansacScratch> ransac_scratch_;  /**< Buffers of each ransac thread, reused by every call */
+    std::mutex ransac_mutex_;  /**< Lets the concurrent sweeps take turns using ransac_pool_ and ransac_scratch_ */
     vtkSmartPointer<vtkPolyData> input_mesh_; /**< input mesh to operate on */
-    std::vector<ProcessPath> paths_; /**< series of intersecting lines on the given mesh */
+    MeshIntersector intersector_; /**< intersects cutting surfaces with the input mesh, built once per input mesh */
+    vtk_viewer::CellAdjacency adjacency_; /**< edge neighbors and boundary (outer boundary and hole) edges of the input mesh cells */
+    std::vector<Raster> rasters_; /**< series of intersecting lines on the given mesh */
     ProcessTool tool_; /**< The tool parameters which defines how to generate the tool paths (spacing, offset, etc.) */
 
     double cut_direction_ [3];
     double cut_centroid_ [3];
 
+    /**
+     * @brief addStat Adds to a counter of the planning statistics if collection is on
+     * @param counter The counter, a member of stats_
+     * @param count The amount to add
+     */
+    void addStat(long& counter, long count);
+
+    /**
+     * @brief updateScratchStat Raises the peak scratch memory of the planning statistics if collection is on
+     * @param bytes The temporary memory of a step
+     */
+    void updateScratchStat(long bytes);
+
+    /**
+     * @brief recordDebugData Records a planning step if recording is on
+     * @param data The data of the step
+     * @param name The name of the step
+     */
+    void recordDebugData(vtkSmartPointer<vtkPolyData> data, const std::string& name);
+
+    /**
+     * @brief getDebugViewer Gets the debug viewer, creates it (showing the input mesh) if it does not exist yet
+     * @return The debug viewer
+     */
+    vtk_viewer::VTKViewer& getDebugViewer();
+
     /**
      * @brief getCellCentroidData Gets the data for a cell in the input_mesh_
      * @param id The cell id to get data for
@@ -152,12 +394,71 @@ namespace tool_path_planner
     vtkSmartPointer<vtkPolyData> createStartCurve();
 
     /**
-     * @brief smoothData Takes in a spline and returns a series of evenly spaced points with normals and derivatives
-     * @param spline The input spline to operate on
-     * @param points The set of evenly spaced points, with normals
-     * @param derivatives The set of evenly spaced points, with derivative data inserted into the "normals" position
+     * @brief smoothData Fits a spline through intersection points and returns a series of points evenly spaced (by arc
+     * length, pt_spacing apart) along it, with normals and derivatives
+     * @param intersection The intersection points, with their mesh cell ids for barycentric normal estimation
+     * @param path The evenly spaced points with their normals and derivatives
+     */
+    void smoothData(vtkSmartPointer<vtkPolyData> intersection, CompactPath& path);
+
+    /**
+     * @brief estimateNormals Estimates the normals of a set of points with the selected normal estimation method
+     * (nearest neighbors for BARYCENTRIC, which needs the intersection)
+     * @param points The points, 3 values per point
+     * @param normals The unit normals, 3 values per point
      */
-    void smoothData(vtkSmartPointer<vtkParametricSpline> spline, vtkSmartPointer<vtkPolyData>& points, vtkSmartPointer<vtkPolyData>& derivatives);
+    void estimateNormals(const std::vector<double>& points, std::vector<double>& normals);
+
+    /**
+     * @brief estimateNormalsNearest Estimates normals by averaging the normals of the nearest mesh vertices
+     * @param points The points, 3 values per point
+     * @param normals The unit normals, 3 values per point
+     */
+    void estimateNormalsNearest(const std::vector<double>& points, std::vector<double>& normals);
+
+    /**
+     * @brief estimateNormalsRansac Estimates normals by fitting planes to the nearest mesh vertices, the points are
+     * spread over the getNumThreads() threads of ransac_pool_, which keep their buffers from one call to the next
+     * @param points The points, 3 values per point
+     * @param normals The unit normals, 3 values per point
+     */
+    void estimateNormalsRansac(const std::vector<double>& points, std::vector<double>& normals);
+
+    /**
+     * @brief estimateNormalRansac Estimates the normal at a point by fitting a plane to the nearest mesh vertices
+     * @param kd_tree The kd tree of the mesh vertices
+     * @param mesh The mesh with point normals, used to orient the plane normal
+     * @param tool The tool, defines the number of neighbors and the inlier threshold
+     * @param pt The point
+     * @param scratch The buffers of the calling thread
+     * @param normal The estimated unit normal, zero if no plane was found
+     * @return False if no plane was found, the caller reports the failures (it may run on a worker thread)
+     */
+    static bool estimateNormalRansac(vtkKdTreePointLocator* kd_tree, vtkPolyData* mesh, const ProcessTool& tool,
+                                     const double pt[3], RansacScratch& scratch, double normal[3]);
+
+    /**
+     * @brief estimateNormalsBarycentric Estimates the normals of points sampled from a spline through intersection
+     * points by interpolating the vertex normals of the mesh cell each point lies on
+     * @param points The points, 3 values per point.  Points whose cell is unknown, which includes the points in the gaps
+     * between the stitched lines of the intersection, fall back to the nearest neighbor estimate.
+     * @param intersection The intersection points the spline interpolates, with the MESH_CELL_IDS point data
+     * @param params The spline parameter (chord length along the intersection points) of every point
+     * @param normals The unit normals, 3 values per point
+     * @return False if the intersection has no cell ids, the normals are not set in that case
+     */
+    bool estimateNormalsBarycentric(const std::vector<double>& points, vtkSmartPointer<vtkPolyData> intersection,
+                                    const std::vector<double>& params, std::vector<double>& normals);
+
+    /**
+     * @brief interpolateNormal Interpolates the vertex normals of a mesh cell at the barycentric coordinates of a point
+     * projected onto the cell (polygons are split into triangle fans)
+     * @param pt The point
+     * @param cell The id of the input mesh cell
+     * @param normal The interpolated unit normal
+     * @return False if the cell is not a polygon or its vertices have no valid normals
+     */
+    bool interpolateNormal(const double pt[3], vtkIdType cell, double normal[3]);
 
     /**
      * @brief generateNormals Generates point normals for a given mesh, normals are located on polydata vertices
@@ -166,13 +467,12 @@ namespace tool_path_planner
     void generateNormals(vtkSmartPointer<vtkPolyData>& data);
 
     /**
-     * @brief createOffsetLine Given a line with normals, generate a new line which is offset by a given distance
-     * @param line Start line
-     * @param derivatives Derivatives of the start line
+     * @brief createOffsetLine Given a path with normals and derivatives, generate a new line which is offset by a given distance
+     * @param path Start path
      * @param dist The amount and direction to offset
-     * @return The newly created line
+     * @return The newly created line, with normals
      */
-    vtkSmartPointer<vtkPolyData> createOffsetLine(vtkSmartPointer<vtkPolyData> line, vtkSmartPointer<vtkPolyData> derivatives, double dist);
+    vtkSmartPointer<vtkPolyData> createOffsetLine(const CompactPath& path, double dist);
 
     /**
      * @brief createSurfaceFromSpline Using a line with normals, generate a surface with points above and below the line (used for mesh intersection calculation)
@@ -182,6 +482,16 @@ namespace tool_path_planner
      */
     vtkSmartPointer<vtkPolyData> createSurfaceFromSpline(vtkSmartPointer<vtkPolyData> line, double dist);
 
+    /**
+     * @brief createSurfaceFromSpline Generates a surface with points above and below a line given by points and normals
+     * @param points The line points, 3 values per point
+     * @param normals The line normals, 3 values per point
+     * @param dist The amount to extend above and below the line for generating the new surface
+     * @return The new surface, in the form of a mesh
+     */
+    vtkSmartPointer<vtkPolyData> createSurfaceFromSpline(const std::vector<double>& points,
+                                                         const std::vector<double>& normals, double dist);
+
     /**
      * @brief sortPoints Sorts points in order to form a contiguous line with the shortest length possible
      * @param points The input points to reorder
@@ -191,7 +501,8 @@ namespace tool_path_planner
     /**
      * @brief findIntersectionLine Given an cutting mesh, finds the intersection of the mesh and the input_mesh_
      * @param cut_surface The mesh to intersect with the input_mesh_
-     * @param points The points found on the intersection of the two meshes
+     * @param points The points found on the intersection of the two meshes, with the id of the mesh cell of the segment
+     * from each point to the next in the MESH_CELL_IDS point data array (see getConnectedIntersectionLine())
      * @param spline A smoothed spline which is generated from the points found from the intersection
      * @return True if the two meshes intersect, False if they do not (no point or spline data)
      */
@@ -201,28 +512,117 @@ namespace tool_path_planner
 
     /**
      * @brief getConnectedIntersectionLine Given a series of lines, returns a single continuous line while filtering out small segments
-     * @param line The input line data (usually obtained from the vtkIntersectionFilter)
+     * @param line The input line data (usually obtained from the MeshIntersector)
      * @param points The list of points in order creating a continuous line
+     * @param cell_ids The id of the mesh cell of the segment from each point to the next one, taken from the
+     * MESH_CELL_IDS cell data of the line segments.  -1 if not available, and for the last point of every stitched line
+     * since the gap to the next line is not on the mesh
      */
-    void getConnectedIntersectionLine(vtkSmartPointer<vtkPolyData> line, vtkSmartPointer<vtkPoints>& points);
+    void getConnectedIntersectionLine(vtkSmartPointer<vtkPolyData> line, vtkSmartPointer<vtkPoints>& points,
+                                      vtkSmartPointer<vtkIdTypeArray>& cell_ids);
 
     /**
-     * @brief getConnectedIntersectionLine Given an intersection line data and a start location, finds and returns a list of connected line segments
-     * @param line The line data from a vtkIntersectionFilter (or other line data object)
-     * @param points The output points which form the continuous line segment
-     * @param used_ids The list of ids used in this line segment
-     * @param start_pt Optional: the point id in the line to start from (useful when performing this operation multiple times)
+     * @brief createPath Creates a raster (smoothed line with normals and derivatives, and cutting surface) from
+     * intersection points which are already known, without intersecting the mesh again
+     * @param intersection The connected intersection points, stored in the raster
+     * @param raster The raster created
+     * @return True if the path has at least 2 points after smoothing
+     */
+    bool createPath(vtkSmartPointer<vtkPolyData> intersection, Raster& raster);
+
+    /**
+     * @brief getFirstRaster Generates the first raster by intersecting the mesh with a surface through the start curve,
+     * replaces all stored rasters with it
+     * @param raster The first raster
+     * @return True if the first raster was created
+     */
+    bool getFirstRaster(Raster& raster);
+
+    /**
+     * @brief createRaster Converts a path given to the public API into a raster
+     * @param path The path
+     * @return The raster
+     */
+    static Raster createRaster(const ProcessPath& path);
+
+    /**
+     * @brief createProcessPath Creates the path returned by the public API from a raster
+     * @param raster The raster
+     * @return The path with its VTK data
+     */
+    static ProcessPath createProcessPath(const Raster& raster);
+
+    /**
+     * @brief getConnectedIntersectionLine Given an intersection line data and a start location, walks the connected line
+     * segments in both directions from the start point
+     * @param line The line data from the MeshIntersector (or other line data object)
+     * @param offsets The point adjacency offsets, the neighbors of point i are neighbors[offsets[i], offsets[i + 1])
+     * @param neighbors The point adjacency lists
+     * @param visited Points already used by a line segment, updated with the points used by this one
+     * @param start_pt The point id in the line to start from
+     * @param ids The ids of the points forming the continuous line segment, in order
      * @return the length of the line segment returned
      */
-    double getConnectedIntersectionLine(vtkSmartPointer<vtkPolyData> line, vtkSmartPointer<vtkPoints>& points, std::vector<int> &used_ids, int start_pt = 0);
+    double getConnectedIntersectionLine(vtkSmartPointer<vtkPolyData> line, const std::vector<vtkIdType>& offsets,
+                                        const std::vector<vtkIdType>& neighbors, std::vector<bool>& visited,
+                                        vtkIdType start_pt, std::deque<vtkIdType>& ids);
+
+    /**
+     * @brief getNextRaster Creates the next raster offset from the current raster, see the public getNextPath()
+     * @param this_raster The current raster, from which to create an offset raster
+     * @param next_raster The next raster returned after calling the function
+     * @param dist The distance to offset the next raster from the current
+     * @param check_surfaces The cutting surfaces of existing rasters, no raster is created if its cutting surface intersects any of them
+     * @return True if the next raster is successfully created, False if no raster can be generated
+     */
+    bool getNextRaster(const Raster& this_raster, Raster& next_raster, double dist,
+                       const std::vector<vtkSmartPointer<vtkPolyData> >& check_surfaces);
+
+    /**
+     * @brief computeSweepsConcurrently Grows rasters from the first raster in both directions at the same time, cuts
+     * the two sweeps where they first intersect and adds them to rasters_ in the same order as the sequential sweeps
+     * @param max The maximum number of paths to create in each direction
+     */
+    void computeSweepsConcurrently(int max);
+
+    /**
+     * @brief getSweepLimit Gets the number of rasters to grow on each side of the first path, max_rasters_ or, if that
+     * is unlimited, enough to cover the extent of the input mesh
+     * @return The maximum number of rasters per side
+     */
+    int getSweepLimit();
+
+    /**
+     * @brief computeStraightRasters Slices the mesh with planes through the start curve and parallel to it, spaced
+     * line_spacing apart, and stores one raster per plane in rasters_
+     * @return True if at least one path was created
+     */
+    bool computeStraightRasters();
+
+    /**
+     * @brief surfacesIntersect Checks if two cutting surfaces intersect each other, stops at the first intersection.
+     * Surfaces whose bounding boxes do not overlap are rejected without building a hierarchy.
+     * @param surface1 The first surface
+     * @param surface2 The second surface
+     * @return True if the surfaces intersect
+     */
+    bool surfacesIntersect(vtkSmartPointer<vtkPolyData> surface1, vtkSmartPointer<vtkPolyData> surface2);
+
+    /**
+     * @brief checkPathForHoles Checks a given raster to determine if it needs to be broken up if there is a large hole in the middle
+     * @param raster The input raster to be checked for large holes/gaps
+     * @param out_rasters The output rasters, after any splitting is performed.  Is empty if no splitting is needed
+     * @return True if a large hole is detected and raster was broken up, false if no splitting is needed
+     */
+    bool checkPathForHoles(const Raster& raster, std::vector<Raster>& out_rasters);
 
     /**
-     * @brief checkPathForHoles Checks a given path to determine if it needs to be broken up if there is a large hole in the middle
-     * @param path The input path to be checked for large holes/gaps
-     * @param out_paths The output paths, after any splitting is performed.  Is empty if no splitting is needed
-     * @return True if a large hole is detected and path was broken up, false if no splitting is needed
+     * @brief isOnBoundary Checks if a point lies on a boundary edge of a mesh cell
+     * @param pt The point
+     * @param cell The id of the mesh cell the point lies on
+     * @return True if the point is on one of the boundary edges of the cell
      */
-    bool checkPathForHoles(const ProcessPath path, std::vector<ProcessPath>& out_paths);
+    bool isOnBoundary(const double pt[3], vtkIdType cell);
 
     /**
      * @brief resamplePoints Resamples a set of points to make them evenly spaced, creates and samples a spline through the original point set
@@ -7,6 +7,8 @@
 #ifndef TOOL_PATH_PLANNER_H
 #define TOOL_PATH_PLANNER_H
 
+#include <vector>
+
 #include <vtkSmartPointer.h>
 #include <vtkPolyData.h>
 #include <vtkParametricSpline.h>
@@ -23,6 +25,16 @@ namespace tool_path_planner
     vtkSmartPointer<vtkParametricSpline> spline; // spline used to generate the line lamda goes from 0 to 1 as the line goes from start to finish
     vtkSmartPointer<vtkPolyData> derivatives; // derivatives are the direction of motion along the spline
     vtkSmartPointer<vtkPolyData> intersection_plane; // May belong here, ok to return empty{}, used by the raster_tool_path_planner and returned for display
+    vtkSmartPointer<vtkPolyData> intersection; // raw connected intersection points of the intersection_plane with the mesh, in the order found, with the id of the mesh cell each point lies on (MeshCellIds point data), ok to return empty{}
+  };
+
+  struct CompactPath
+  {
+    std::vector<double> points; // x, y, z of every path point, stored contiguously (same locations as ProcessPath::line)
+    std::vector<double> normals; // x, y, z of the unit normal (z-axis orientation of the tool) at every point
+    std::vector<double> derivatives; // x, y, z of the unit derivative at every point (same as ProcessPath::derivatives)
+
+    int size() const {return points.size() / 3;} // number of path points
   };
 
   struct ProcessTool
@@ -116,6 +128,26 @@ namespace tool_path_planner
    */
   void flipPointOrder(ProcessPath& path);
 
+  /**
+   * @brief flipPointOrder Inverts a compact path, points, normals, and derivatives
+   * @param path The input path to invert
+   */
+  void flipPointOrder(CompactPath& path);
+
+  /**
+   * @brief createProcessPath Creates the VTK data (line with normals, derivatives and spline) of a compact path
+   * @param compact The compact path
+   * @param path The path, line, derivatives and spline are replaced, the other members are not modified
+   */
+  void createProcessPath(const CompactPath& compact, ProcessPath& path);
+
+  /**
+   * @brief createCompactPath Copies the line, normals and derivatives of a path into a compact path
+   * @param path The path
+   * @param compact The compact path
+   */
+  void createCompactPath(const ProcessPath& path, CompactPath& compact);
+
   /**
    * @brief findClosestPoint Finds the closest point in a list to a target point
    * @param pt The target point
@@ -0,0 +1,547 @@
+/*
+ * Copyright (c) 2016, Southwest Research Institute
+ * All rights reserved.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+
+#include <vtkPoints.h>
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkIdTypeArray.h>
+#include <vtkMath.h>
+
+#include <tool_path_planner/mesh_intersector.h>
+
+namespace tool_path_planner
+{
+  namespace
+  {
+    const int LEAF_SIZE = 4;  /**< Maximum number of triangles in a leaf node */
+
+    /**
+     * @brief Crossing point of a triangle edge with a plane, located by its position along the intersection line
+     */
+    struct EdgeCrossing
+    {
+      vtkIdType edge[2];
+      double pt[3];
+      double s;
+    };
+
+    /**
+     * @brief getCrossings Finds the two edges of a triangle which cross a plane.  The crossing point is computed from
+     * the sorted edge (or taken from the corner if it lies on the plane) so neighboring triangles sharing the edge
+     * compute exactly the same point.
+     * @param ids The triangle point ids
+     * @param pts The triangle corners
+     * @param dist The signed distance of each corner to the plane
+     * @param crossings The two crossings found
+     * @return False if all corners are on the same side of the plane
+     */
+    bool getCrossings(const vtkIdType ids[3], const double pts[3][3], const double dist[3], EdgeCrossing crossings[2])
+    {
+      int num = 0;
+      for(int i = 0; i < 3; ++i)
+      {
+        int a = i;
+        int b = (i + 1) % 3;
+        if((dist[a] >= 0.0) == (dist[b] >= 0.0))
+        {
+          continue;
+        }
+        if(ids[b] < ids[a])
+        {
+          std::swap(a, b);
+        }
+
+        EdgeCrossing& crossing = crossings[num++];
+        if(dist[a] == 0.0 || dist[b] == 0.0)
+        {
+          // crossing at a corner, shared by every edge which ends there
+          int c = dist[a] == 0.0 ? a : b;
+          crossing.edge[0] = crossing.edge[1] = ids[c];
+          std::copy(pts[c], pts[c] + 3, crossing.pt);
+          continue;
+        }
+
+        crossing.edge[0] = ids[a];
+        crossing.edge[1] = ids[b];
+        double t = dist[a] / (dist[a] - dist[b]);
+        for(int j = 0; j < 3; ++j)
+        {
+          crossing.pt[j] = pts[a][j] + (pts[b][j] - pts[a][j]) * t;
+        }
+      }
+      return num == 2;
+    }
+
+    void getNormal(const double pts[3][3], double normal[3])
+    {
+      double v1[3], v2[3];
+      for(int i = 0; i < 3; ++i)
+      {
+        v1[i] = pts[1][i] - pts[0][i];
+        v2[i] = pts[2][i] - pts[0][i];
+      }
+      vtkMath::Cross(v1, v2, normal);
+    }
+
+    void getPlaneDistances(const double pts[3][3], const double origin[3], const double normal[3], double dist[3])
+    {
+      for(int i = 0; i < 3; ++i)
+      {
+        double v[3] = {pts[i][0] - origin[0], pts[i][1] - origin[1], pts[i][2] - origin[2]};
+        dist[i] = vtkMath::Dot(normal, v);
+      }
+    }
+
+    void getBounds(const double pts[3][3], double min[3], double max[3])
+    {
+      for(int i = 0; i < 3; ++i)
+      {
+        min[i] = std::min(pts[0][i], std::min(pts[1][i], pts[2][i]));
+        max[i] = std::max(pts[0][i], std::max(pts[1][i], pts[2][i]));
+      }
+    }
+  }
+
+  bool MeshIntersector::PointKey::operator<(const PointKey& other) const
+  {
+    if(type != other.type)
+    {
+      return type < other.type;
+    }
+    if(triangle != other.triangle)
+    {
+      return triangle < other.triangle;
+    }
+    if(edge[0] != other.edge[0])
+    {
+      return edge[0] < other.edge[0];
+    }
+    return edge[1] < other.edge[1];
+  }
+
+  void MeshIntersector::setInputMesh(vtkSmartPointer<vtkPolyData> mesh)
+  {
+    mesh_ = mesh;
+    triangles_.clear();
+    nodes_.clear();
+    if(!mesh_ || !mesh_->GetPoints() || !mesh_->GetPolys())
+    {
+      return;
+    }
+
+    // mesh cell ids number verts and lines before polys
+    vtkIdType cell_id = mesh_->GetNumberOfVerts() + mesh_->GetNumberOfLines();
+    vtkCellArray* polys = mesh_->GetPolys();
+    const vtkIdType* ptr = polys->GetPointer();
+    const vtkIdType* end = ptr + polys->GetNumberOfConnectivityEntries();
+    triangles_.reserve(polys->GetNumberOfCells());
+    while(ptr < end)
+    {
+      vtkIdType npts = *ptr++;
+      for(vtkIdType i = 1; i + 1 < npts; ++i)
+      {
+        MeshTriangle tri;
+        tri.ids[0] = ptr[0];
+        tri.ids[1] = ptr[i];
+        tri.ids[2] = ptr[i + 1];
+        tri.cell = cell_id;
+        triangles_.push_back(tri);
+      }
+      ptr += npts;
+      ++cell_id;
+    }
+
+    if(triangles_.empty())
+    {
+      return;
+    }
+
+    vtkPoints* points = mesh_->GetPoints();
+    std::vector<double> centroids(3 * triangles_.size(), 0.0);
+    for(int i = 0; i < triangles_.size(); ++i)
+    {
+      for(int j = 0; j < 3; ++j)
+      {
+        double pt[3];
+        points->GetPoint(triangles_[i].ids[j], pt);
+        for(int k = 0; k < 3; ++k)
+        {
+          centroids[3 * i + k] += pt[k] / 3.0;
+        }
+      }
+    }
+
+    nodes_.reserve(2 * (triangles_.size() / LEAF_SIZE + 1));
+    buildNode(0, triangles_.size(), centroids);
+  }
+
+  int MeshIntersector::buildNode(int start, int count, std::vector<double>& centroids)
+  {
+    vtkPoints* points = mesh_->GetPoints();
+
+    Node node;
+    double cmin[3], cmax[3];
+    for(int k = 0; k < 3; ++k)
+    {
+      node.min[k] = cmin[k] = std::numeric_limits<double>::max();
+      node.max[k] = cmax[k] = -std::numeric_limits<double>::max();
+    }
+    for(int i = start; i < start + count; ++i)
+    {
+      for(int j = 0; j < 3; ++j)
+      {
+        double pt[3];
+        points->GetPoint(triangles_[i].ids[j], pt);
+        for(int k = 0; k < 3; ++k)
+        {
+          node.min[k] = std::min(node.min[k], pt[k]);
+          node.max[k] = std::max(node.max[k], pt[k]);
+        }
+      }
+      for(int k = 0; k < 3; ++k)
+      {
+        cmin[k] = std::min(cmin[k], centroids[3 * i + k]);
+        cmax[k] = std::max(cmax[k], centroids[3 * i + k]);
+      }
+    }
+    node.start = start;
+    node.count = count;
+    node.right = -1;
+
+    int index = nodes_.size();
+    nodes_.push_back(node);
+    if(count <= LEAF_SIZE)
+    {
+      return index;
+    }
+
+    // split at the median centroid along the longest axis
+    int axis = 0;
+    for(int k = 1; k < 3; ++k)
+    {
+      if(cmax[k] - cmin[k] > cmax[axis] - cmin[axis])
+      {
+        axis = k;
+      }
+    }
+
+    std::vector<int> order(count);
+    for(int i = 0; i < count; ++i)
+    {
+      order[i] = start + i;
+    }
+    int half = count / 2;
+    std::nth_element(order.begin(), order.begin() + half, order.end(),
+                     [&centroids, axis](int a, int b) {return centroids[3 * a + axis] < centroids[3 * b + axis];});
+
+    std::vector<MeshTriangle> triangles(count);
+    std::vector<double> node_centroids(3 * count);
+    for(int i = 0; i < count; ++i)
+    {
+      triangles[i] = triangles_[order[i]];
+      std::copy(&centroids[3 * order[i]], &centroids[3 * order[i]] + 3, &node_centroids[3 * i]);
+    }
+    std::copy(triangles.begin(), triangles.end(), triangles_.begin() + start);
+    std::copy(node_centroids.begin(), node_centroids.end(), centroids.begin() + 3 * start);
+
+    // the left child is always the next node
+    nodes_[index].count = 0;
+    buildNode(start, half, centroids);
+    int right = buildNode(start + half, count - half, centroids);
+    nodes_[index].right = right;
+    return index;
+  }
+
+  void MeshIntersector::getSurfaceTriangles(vtkSmartPointer<vtkPolyData> surface, std::vector<Triangle>& triangles)
+  {
+    triangles.clear();
+    if(!surface || !surface->GetPoints() || !surface->GetPolys())
+    {
+      return;
+    }
+
+    vtkPoints* points = surface->GetPoints();
+    vtkCellArray* polys = surface->GetPolys();
+    const vtkIdType* ptr = polys->GetPointer();
+    const vtkIdType* end = ptr + polys->GetNumberOfConnectivityEntries();
+    while(ptr < end)
+    {
+      vtkIdType npts = *ptr++;
+      for(vtkIdType i = 1; i + 1 < npts; ++i)
+      {
+        Triangle tri;
+        tri.ids[0] = ptr[0];
+        tri.ids[1] = ptr[i];
+        tri.ids[2] = ptr[i + 1];
+        for(int j = 0; j < 3; ++j)
+        {
+          points->GetPoint(tri.ids[j], tri.pts[j]);
+        }
+        tri.cell = tri.index = triangles.size();
+        triangles.push_back(tri);
+      }
+      ptr += npts;
+    }
+  }
+
+  void MeshIntersector::query(const std::vector<Triangle>& triangles, std::vector<Segment>& segments,
+                              bool first_only) const
+  {
+    if(nodes_.empty())
+    {
+      return;
+    }
+
+    vtkPoints* points = mesh_->GetPoints();
+    std::vector<int> stack;
+    for(int i = 0; i < triangles.size(); ++i)
+    {
+      const Triangle& surface_tri = triangles[i];
+      double min[3], max[3];
+      getBounds(surface_tri.pts, min, max);
+
+      stack.clear();
+      stack.push_back(0);
+      while(!stack.empty())
+      {
+        int index = stack.back();
+        stack.pop_back();
+        const Node& node = nodes_[index];
+
+        bool overlap = true;
+        for(int k = 0; k < 3 && overlap; ++k)
+        {
+          overlap = node.min[k] <= max[k] && min[k] <= node.max[k];
+        }
+        if(!overlap)
+        {
+          continue;
+        }
+
+        if(node.count == 0)
+        {
+          stack.push_back(node.right);
+          stack.push_back(index + 1);
+          continue;
+        }
+
+        for(int j = node.start; j < node.start + node.count; ++j)
+        {
+          Triangle mesh_tri;
+          for(int k = 0; k < 3; ++k)
+          {
+            mesh_tri.ids[k] = triangles_[j].ids[k];
+            points->GetPoint(mesh_tri.ids[k], mesh_tri.pts[k]);
+          }
+          mesh_tri.cell = triangles_[j].cell;
+          mesh_tri.index = j;
+
+          Segment segment;
+          if(intersectTriangles(mesh_tri, surface_tri, segment))
+          {
+            segments.push_back(segment);
+            if(first_only)
+            {
+              return;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  bool MeshIntersector::intersectTriangles(const Triangle& mesh_tri, const Triangle& surface_tri, Segment& segment)
+  {
+    double mesh_normal[3], surface_normal[3];
+    getNormal(mesh_tri.pts, mesh_normal);
+    getNormal(surface_tri.pts, surface_normal);
+
+    // edges of each triangle crossing the plane of the other one
+    double mesh_dist[3], surface_dist[3];
+    getPlaneDistances(mesh_tri.pts, surface_tri.pts[0], surface_normal, mesh_dist);
+    EdgeCrossing mesh_crossings[2];
+    if(!getCrossings(mesh_tri.ids, mesh_tri.pts, mesh_dist, mesh_crossings))
+    {
+      return false;
+    }
+    getPlaneDistances(surface_tri.pts, mesh_tri.pts[0], mesh_normal, surface_dist);
+    EdgeCrossing surface_crossings[2];
+    if(!getCrossings(surface_tri.ids, surface_tri.pts, surface_dist, surface_crossings))
+    {
+      return false;
+    }
+
+    // both pairs of crossings lie on the line where the planes meet, the segment is the overlap of the two intervals
+    double direction[3];
+    vtkMath::Cross(mesh_normal, surface_normal, direction);
+    for(int i = 0; i < 2; ++i)
+    {
+      mesh_crossings[i].s = vtkMath::Dot(direction, mesh_crossings[i].pt);
+      surface_crossings[i].s = vtkMath::Dot(direction, surface_crossings[i].pt);
+    }
+    if(mesh_crossings[1].s < mesh_crossings[0].s)
+    {
+      std::swap(mesh_crossings[0], mesh_crossings[1]);
+    }
+    if(surface_crossings[1].s < surface_crossings[0].s)
+    {
+      std::swap(surface_crossings[0], surface_crossings[1]);
+    }
+
+    const bool start_on_mesh = mesh_crossings[0].s >= surface_crossings[0].s;
+    const bool end_on_mesh = mesh_crossings[1].s <= surface_crossings[1].s;
+    const EdgeCrossing& start = start_on_mesh ? mesh_crossings[0] : surface_crossings[0];
+    const EdgeCrossing& end = end_on_mesh ? mesh_crossings[1] : surface_crossings[1];
+    if(start.s >= end.s)
+    {
+      return false;
+    }
+
+    const EdgeCrossing* crossings[2] = {&start, &end};
+    const bool on_mesh[2] = {start_on_mesh, end_on_mesh};
+    for(int i = 0; i < 2; ++i)
+    {
+      PointKey& key = segment.keys[i];
+      key.type = on_mesh[i] ? 0 : 1;
+      key.edge[0] = crossings[i]->edge[0];
+      key.edge[1] = crossings[i]->edge[1];
+      key.triangle = on_mesh[i] ? surface_tri.index : mesh_tri.index;
+      std::copy(crossings[i]->pt, crossings[i]->pt + 3, segment.pts[i]);
+    }
+    segment.cell = mesh_tri.cell;
+    return true;
+  }
+
+  bool MeshIntersector::intersect(vtkSmartPointer<vtkPolyData> surface, vtkSmartPointer<vtkPolyData>& lines) const
+  {
+    std::vector<Triangle> triangles;
+    getSurfaceTriangles(surface, triangles);
+
+    std::vector<Segment> segments;
+    query(triangles, segments, false);
+    createLines(segments, lines);
+    return !segments.empty();
+  }
+
+  void MeshIntersector::createLines(const std::vector<Segment>& segments, vtkSmartPointer<vtkPolyData>& lines)
+  {
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->SetDataTypeToDouble();
+    vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
+    vtkSmartPointer<vtkIdTypeArray> cell_ids = vtkSmartPointer<vtkIdTypeArray>::New();
+    cell_ids->SetName(MESH_CELL_IDS);
+    cell_ids->SetNumberOfComponents(1);
+
+    // segments computed from neighboring triangles share end points with the same key
+    std::map<PointKey, vtkIdType> point_ids;
+    for(int i = 0; i < segments.size(); ++i)
+    {
+      vtkIdType ids[2];
+      for(int j = 0; j < 2; ++j)
+      {
+        std::map<PointKey, vtkIdType>::iterator it = point_ids.find(segments[i].keys[j]);
+        if(it == point_ids.end())
+        {
+          ids[j] = points->InsertNextPoint(segments[i].pts[j]);
+          point_ids[segments[i].keys[j]] = ids[j];
+        }
+        else
+        {
+          ids[j] = it->second;
+        }
+      }
+      cells->InsertNextCell(2, ids);
+      cell_ids->InsertNextValue(segments[i].cell);
+    }
+
+    lines = vtkSmartPointer<vtkPolyData>::New();
+    lines->SetPoints(points);
+    lines->SetLines(cells);
+    lines->GetCellData()->AddArray(cell_ids);
+  }
+
+  bool MeshIntersector::intersects(vtkSmartPointer<vtkPolyData> surface) const
+  {
+    std::vector<Triangle> triangles;
+    getSurfaceTriangles(surface, triangles);
+
+    std::vector<Segment> segments;
+    query(triangles, segments, true);
+    return !segments.empty();
+  }
+
+  void MeshIntersector::slice(const double normal[3], double offset, double spacing, int num_planes,
+                              std::vector<vtkSmartPointer<vtkPolyData> >& lines) const
+  {
+    lines.clear();
+    if(num_planes <= 0 || spacing <= 0.0)
+    {
+      return;
+    }
+
+    // bucket the segments of every triangle by plane, triangles only span the planes between their lowest and highest
+    // corner so each one is visited once no matter how many planes there are
+    std::vector<std::vector<Segment> > segments(num_planes);
+    vtkPoints* points = triangles_.empty() ? NULL : mesh_->GetPoints();
+    for(int i = 0; i < triangles_.size(); ++i)
+    {
+      Triangle tri;
+      double height[3];
+      for(int k = 0; k < 3; ++k)
+      {
+        tri.ids[k] = triangles_[i].ids[k];
+        points->GetPoint(tri.ids[k], tri.pts[k]);
+        height[k] = vtkMath::Dot(normal, tri.pts[k]);
+      }
+
+      double min = std::min(height[0], std::min(height[1], height[2]));
+      double max = std::max(height[0], std::max(height[1], height[2]));
+      int first = std::max(0, int(std::ceil((min - offset) / spacing)));
+      int last = std::min(num_planes - 1, int(std::floor((max - offset) / spacing)));
+
+      for(int plane = first; plane <= last; ++plane)
+      {
+        double dist[3];
+        double plane_offset = offset + plane * spacing;
+        for(int k = 0; k < 3; ++k)
+        {
+          dist[k] = height[k] - plane_offset;
+        }
+
+        EdgeCrossing crossings[2];
+        if(!getCrossings(tri.ids, tri.pts, dist, crossings) ||
+           (crossings[0].edge[0] == crossings[1].edge[0] && crossings[0].edge[1] == crossings[1].edge[1]))
+        {
+          continue;
+        }
+
+        Segment segment;
+        for(int j = 0; j < 2; ++j)
+        {
+          segment.keys[j].type = 0;
+          segment.keys[j].edge[0] = crossings[j].edge[0];
+          segment.keys[j].edge[1] = crossings[j].edge[1];
+          segment.keys[j].triangle = plane;
+          std::copy(crossings[j].pt, crossings[j].pt + 3, segment.pts[j]);
+        }
+        segment.cell = triangles_[i].cell;
+        segments[plane].push_back(segment);
+      }
+    }
+
+    lines.resize(num_planes);
+    for(int i = 0; i < num_planes; ++i)
+    {
+      createLines(segments[i], lines[i]);
+    }
+  }
+
+}
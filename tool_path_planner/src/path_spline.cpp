@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2016, Southwest Research Institute
+ * All rights reserved.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include <tool_path_planner/path_spline.h>
+
+namespace tool_path_planner
+{
+  namespace
+  {
+    const int SUBDIVISIONS = 4;  /**< Number of arc length table entries per segment */
+
+    /**
+     * @brief Nodes and weights of the 5 point Gauss-Legendre quadrature on [-1, 1]
+     */
+    const double GAUSS_NODES[5] = {0.0, -0.5384693101056831, 0.5384693101056831, -0.9061798459386640, 0.9061798459386640};
+    const double GAUSS_WEIGHTS[5] = {0.5688888888888889, 0.4786286704993665, 0.4786286704993665, 0.2369268850561891,
+                                     0.2369268850561891};
+  }
+
+  bool PathSpline::setPoints(vtkSmartPointer<vtkPoints> points)
+  {
+    knots_.clear();
+    coeffs_.clear();
+    lengths_.clear();
+
+    // input points without consecutive duplicates and their chord length parameter
+    std::vector<double> pts;
+    vtkIdType num_input = points ? points->GetNumberOfPoints() : 0;
+    for(vtkIdType i = 0; i < num_input; ++i)
+    {
+      double pt[3];
+      points->GetPoint(i, pt);
+      if(knots_.empty())
+      {
+        knots_.push_back(0.0);
+      }
+      else
+      {
+        const double* last = &pts[pts.size() - 3];
+        double dist = std::sqrt((pt[0] - last[0]) * (pt[0] - last[0]) + (pt[1] - last[1]) * (pt[1] - last[1]) +
+                                (pt[2] - last[2]) * (pt[2] - last[2]));
+        if(dist == 0.0)
+        {
+          continue;
+        }
+        knots_.push_back(knots_.back() + dist);
+      }
+      pts.insert(pts.end(), pt, pt + 3);
+    }
+
+    int num = knots_.size();
+    if(num < 2)
+    {
+      knots_.clear();
+      return false;
+    }
+
+    // second derivatives of the natural spline (zero at the ends), the tridiagonal system is solved for all three
+    // coordinates at once with the Thomas algorithm
+    std::vector<double> m(3 * num, 0.0);
+    if(num > 2)
+    {
+      std::vector<double> diag(num, 0.0), upper(num, 0.0), rhs(3 * num, 0.0);
+      for(int i = 1; i < num - 1; ++i)
+      {
+        double h0 = knots_[i] - knots_[i - 1];
+        double h1 = knots_[i + 1] - knots_[i];
+        double lower = h0;
+        diag[i] = 2.0 * (h0 + h1);
+        upper[i] = (i < num - 2) ? h1 : 0.0;
+        for(int j = 0; j < 3; ++j)
+        {
+          rhs[3 * i + j] = 6.0 * ((pts[3 * (i + 1) + j] - pts[3 * i + j]) / h1 - (pts[3 * i + j] - pts[3 * (i - 1) + j]) / h0);
+        }
+
+        // eliminate the lower diagonal using the previous row
+        if(i > 1)
+        {
+          double factor = lower / diag[i - 1];
+          diag[i] -= factor * upper[i - 1];
+          for(int j = 0; j < 3; ++j)
+          {
+            rhs[3 * i + j] -= factor * rhs[3 * (i - 1) + j];
+          }
+        }
+      }
+      for(int i = num - 2; i >= 1; --i)
+      {
+        for(int j = 0; j < 3; ++j)
+        {
+          m[3 * i + j] = (rhs[3 * i + j] - upper[i] * m[3 * (i + 1) + j]) / diag[i];
+        }
+      }
+    }
+
+    coeffs_.resize(12 * (num - 1));
+    for(int i = 0; i < num - 1; ++i)
+    {
+      double h = knots_[i + 1] - knots_[i];
+      for(int j = 0; j < 3; ++j)
+      {
+        double* c = &coeffs_[12 * i + 4 * j];
+        double y0 = pts[3 * i + j];
+        double y1 = pts[3 * (i + 1) + j];
+        double m0 = m[3 * i + j];
+        double m1 = m[3 * (i + 1) + j];
+        c[0] = y0;
+        c[1] = (y1 - y0) / h - h * (2.0 * m0 + m1) / 6.0;
+        c[2] = m0 / 2.0;
+        c[3] = (m1 - m0) / (6.0 * h);
+      }
+    }
+
+    // arc length table
+    lengths_.resize(SUBDIVISIONS * (num - 1) + 1);
+    lengths_[0] = 0.0;
+    for(int i = 0; i < num - 1; ++i)
+    {
+      double step = (knots_[i + 1] - knots_[i]) / SUBDIVISIONS;
+      for(int k = 0; k < SUBDIVISIONS; ++k)
+      {
+        int entry = SUBDIVISIONS * i + k;
+        lengths_[entry + 1] = lengths_[entry] + segmentLength(i, k * step, (k + 1) * step);
+      }
+    }
+
+    return true;
+  }
+
+  void PathSpline::evaluate(double t, double pt[3], double tangent[3]) const
+  {
+    if(knots_.empty())
+    {
+      return;
+    }
+
+    t = std::max(0.0, std::min(knots_.back(), t));
+    int segment = findSegment(t);
+    double u = t - knots_[segment];
+    const double* c = &coeffs_[12 * segment];
+    for(int j = 0; j < 3; ++j)
+    {
+      pt[j] = c[4 * j] + u * (c[4 * j + 1] + u * (c[4 * j + 2] + u * c[4 * j + 3]));
+    }
+
+    if(tangent)
+    {
+      double norm = 0.0;
+      for(int j = 0; j < 3; ++j)
+      {
+        tangent[j] = c[4 * j + 1] + u * (2.0 * c[4 * j + 2] + 3.0 * u * c[4 * j + 3]);
+        norm += tangent[j] * tangent[j];
+      }
+      norm = std::sqrt(norm);
+      if(norm > 0.0)
+      {
+        tangent[0] /= norm;
+        tangent[1] /= norm;
+        tangent[2] /= norm;
+      }
+    }
+  }
+
+  void PathSpline::resample(double spacing, std::vector<double>& points, std::vector<double>& tangents,
+                            std::vector<double>& params) const
+  {
+    points.clear();
+    tangents.clear();
+    params.clear();
+
+    double length = getLength();
+    if(length <= 0.0 || spacing <= 0.0)
+    {
+      return;
+    }
+
+    int num = std::max(1, int(std::floor(length / spacing + 0.5)));
+    points.resize(3 * (num + 1));
+    tangents.resize(3 * (num + 1));
+    params.resize(num + 1);
+
+    // the lengths increase, so the table is searched in a single pass for all points
+    int entry = 0;
+    for(int i = 0; i <= num; ++i)
+    {
+      params[i] = (i == num) ? knots_.back() : findParameter(length * double(i) / double(num), entry);
+      evaluate(params[i], &points[3 * i], &tangents[3 * i]);
+    }
+  }
+
+  int PathSpline::findSegment(double t) const
+  {
+    int segment = std::upper_bound(knots_.begin(), knots_.end(), t) - knots_.begin() - 1;
+    return std::max(0, std::min(int(knots_.size()) - 2, segment));
+  }
+
+  double PathSpline::speed(int segment, double u) const
+  {
+    const double* c = &coeffs_[12 * segment];
+    double sum = 0.0;
+    for(int j = 0; j < 3; ++j)
+    {
+      double d = c[4 * j + 1] + u * (2.0 * c[4 * j + 2] + 3.0 * u * c[4 * j + 3]);
+      sum += d * d;
+    }
+    return std::sqrt(sum);
+  }
+
+  double PathSpline::segmentLength(int segment, double u0, double u1) const
+  {
+    double half = 0.5 * (u1 - u0);
+    double mid = 0.5 * (u1 + u0);
+    double sum = 0.0;
+    for(int i = 0; i < 5; ++i)
+    {
+      sum += GAUSS_WEIGHTS[i] * speed(segment, mid + half * GAUSS_NODES[i]);
+    }
+    return half * sum;
+  }
+
+  double PathSpline::findParameter(double length, int& start) const
+  {
+    int last = lengths_.size() - 2;
+    while(start < last && lengths_[start + 1] <= length)
+    {
+      ++start;
+    }
+
+    int segment = start / SUBDIVISIONS;
+    double step = (knots_[segment + 1] - knots_[segment]) / SUBDIVISIONS;
+    double lower = (start % SUBDIVISIONS) * step;
+    double upper = lower + step;
+    double target = length - lengths_[start];
+    double entry_length = lengths_[start + 1] - lengths_[start];
+    if(entry_length <= 0.0)
+    {
+      return knots_[segment] + lower;
+    }
+
+    // Newton's method on the arc length inside the table entry, falling back to bisection if a step leaves the bracket
+    double a = lower;
+    double b = upper;
+    double u = lower + step * std::max(0.0, std::min(1.0, target / entry_length));
+    for(int i = 0; i < 20; ++i)
+    {
+      double f = segmentLength(segment, lower, u) - target;
+      if(std::abs(f) <= 1e-12 * std::max(1.0, entry_length))
+      {
+        break;
+      }
+      if(f > 0.0)
+      {
+        b = u;
+      }
+      else
+      {
+        a = u;
+      }
+
+      double df = speed(segment, u);
+      double next = (df > 0.0) ? u - f / df : a - 1.0;
+      u = (next > a && next < b) ? next : 0.5 * (a + b);
+    }
+    return knots_[segment] + u;
+  }
+
+}
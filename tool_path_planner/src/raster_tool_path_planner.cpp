@@ -4,14 +4,17 @@
  *
  */
 
+#include <algorithm>
+#include <chrono>
 #include <limits>
 #include <cmath>
+#include <memory>
+#include <mutex>
 
 #include <Eigen/Core>
 
 #include <vtkParametricFunctionSource.h>
 #include <vtkOBBTree.h>
-#include <vtkIntersectionPolyDataFilter.h>
 #include <vtkDelaunay2D.h>
 #include <vtkMath.h>
 #include <vtkSpline.h>
@@ -22,11 +25,11 @@
 #include <vtkCellData.h>
 #include <vtkTriangle.h>
 #include <vtk_viewer/vtk_utils.h>
+#include <vtk_viewer/thread_pool.h>
+#include <vtk_viewer/trace.h>
 #include <vtkReverseSense.h>
 #include <vtkImplicitDataSet.h>
 #include <vtkCutter.h>
-#include <vtkCellLocator.h>
-#include <vtkGenericCell.h>
 #include <vtkTriangleFilter.h>
 
 #include <pcl/surface/vtk_smoothing/vtk_utils.h>
@@ -37,46 +40,401 @@
 #include <pcl/sample_consensus/ransac.h>
 #include <pcl/sample_consensus/sac_model_plane.h>
 #include <tool_path_planner/raster_tool_path_planner.h>
+#include <tool_path_planner/path_spline.h>
 
 namespace tool_path_planner
 {
+  /**
+   * @brief extractPoints Copies a range of the points of a line, together with their mesh cell ids
+   * @param line The line
+   * @param start The first point to copy
+   * @param end One past the last point to copy
+   * @return The new line
+   */
+  static vtkSmartPointer<vtkPolyData> extractPoints(vtkSmartPointer<vtkPolyData> line, int start, int end)
+  {
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->SetDataTypeToDouble();
+    points->SetNumberOfPoints(end - start);
+    vtkIdTypeArray* cell_ids = vtkIdTypeArray::SafeDownCast(line->GetPointData()->GetArray(MESH_CELL_IDS));
+    vtkSmartPointer<vtkIdTypeArray> new_cell_ids = vtkSmartPointer<vtkIdTypeArray>::New();
+    new_cell_ids->SetName(MESH_CELL_IDS);
+    for(int i = start; i < end; ++i)
+    {
+      double pt[3];
+      line->GetPoints()->GetPoint(i, pt);
+      points->SetPoint(i - start, pt);
+      new_cell_ids->InsertNextValue(cell_ids ? cell_ids->GetValue(i) : -1);
+    }
+
+    vtkSmartPointer<vtkPolyData> new_line = vtkSmartPointer<vtkPolyData>::New();
+    new_line->SetPoints(points);
+    new_line->GetPointData()->AddArray(new_cell_ids);
+    return new_line;
+  }
+
+  /**
+   * @brief getPointBounds Computes the bounding box of the points of a polydata without touching the cached bounds of
+   * the polydata, so it is safe to call while other threads read the same polydata
+   * @param data The polydata
+   * @param bounds The bounding box (xmin, xmax, ymin, ymax, zmin, zmax)
+   * @return False if the polydata has no points
+   */
+  static bool getPointBounds(vtkSmartPointer<vtkPolyData> data, double bounds[6])
+  {
+    if(!data || !data->GetPoints() || data->GetPoints()->GetNumberOfPoints() == 0)
+    {
+      return false;
+    }
+
+    bounds[0] = bounds[2] = bounds[4] = std::numeric_limits<double>::max();
+    bounds[1] = bounds[3] = bounds[5] = -std::numeric_limits<double>::max();
+    for(vtkIdType i = 0; i < data->GetPoints()->GetNumberOfPoints(); ++i)
+    {
+      double pt[3];
+      data->GetPoints()->GetPoint(i, pt);
+      for(int j = 0; j < 3; ++j)
+      {
+        bounds[2 * j] = std::min(bounds[2 * j], pt[j]);
+        bounds[2 * j + 1] = std::max(bounds[2 * j + 1], pt[j]);
+      }
+    }
+    return true;
+  }
+
+  /**
+   * @brief getPointArray Copies the points of a poly data into an array
+   * @param data The poly data
+   * @param points The points, 3 values per point
+   */
+  static void getPointArray(vtkSmartPointer<vtkPolyData> data, std::vector<double>& points)
+  {
+    vtkIdType num_pts = data->GetPoints() ? data->GetPoints()->GetNumberOfPoints() : 0;
+    points.resize(3 * num_pts);
+    for(vtkIdType i = 0; i < num_pts; ++i)
+    {
+      data->GetPoints()->GetPoint(i, &points[3 * i]);
+    }
+  }
+
+  /**
+   * @brief setNormalArray Sets the point normals of a poly data from an array
+   * @param data The poly data
+   * @param normals The normals, 3 values per point
+   */
+  static void setNormalArray(vtkSmartPointer<vtkPolyData> data, const std::vector<double>& normals)
+  {
+    vtkSmartPointer<vtkDoubleArray> new_norm = vtkSmartPointer<vtkDoubleArray>::New();
+    new_norm->SetNumberOfComponents(3);
+    new_norm->SetNumberOfTuples(normals.size() / 3);
+    for(vtkIdType i = 0; i < new_norm->GetNumberOfTuples(); ++i)
+    {
+      new_norm->SetTuple(i, &normals[3 * i]);
+    }
+
+    // Insert the normal data
+    data->GetPointData()->SetNormals(new_norm);
+  }
+
+  /**
+   * @brief Adds the wall time of its scope to a stage of the planner statistics, does nothing without a stage
+   */
+  class StageTimer
+  {
+  public:
+
+    /**
+     * @brief constructor, starts timing
+     * @param stage The stage time to add to, NULL if statistics are not collected
+     * @param mutex The mutex protecting the stage time
+     */
+    StageTimer(double* stage, std::mutex& mutex):
+      stage_(stage),
+      mutex_(mutex)
+    {
+      if(stage_)
+      {
+        start_ = std::chrono::steady_clock::now();
+      }
+    }
+
+    ~StageTimer()
+    {
+      if(stage_)
+      {
+        std::chrono::duration<double> time = std::chrono::steady_clock::now() - start_;
+        std::lock_guard<std::mutex> lock(mutex_);
+        *stage_ += time.count();
+      }
+    }
+
+  private:
+    double* stage_;  /**< The stage time, NULL if not timing */
+    std::mutex& mutex_;  /**< The mutex protecting the stage time */
+    std::chrono::steady_clock::time_point start_;  /**< The time the scope was entered */
+  };
+
+  /**
+   * @brief addStats Adds the statistics of a planning call to a total
+   * @param total The total
+   * @param stats The statistics to add, the peak scratch memory is the maximum of both
+   */
+  static void addStats(PlannerStats& total, const PlannerStats& stats)
+  {
+    total.total_time += stats.total_time;
+    total.setup_time += stats.setup_time;
+    total.intersection_time += stats.intersection_time;
+    total.smoothing_time += stats.smoothing_time;
+    total.normal_estimation_time += stats.normal_estimation_time;
+    total.hole_check_time += stats.hole_check_time;
+    total.self_intersection_time += stats.self_intersection_time;
+    total.intersections += stats.intersections;
+    total.self_intersection_checks += stats.self_intersection_checks;
+    total.kd_tree_queries += stats.kd_tree_queries;
+    total.ransac_failures += stats.ransac_failures;
+    total.points += stats.points;
+    total.peak_scratch_bytes = std::max(total.peak_scratch_bytes, stats.peak_scratch_bytes);
+  }
+
+  /**
+   * @brief Number of points estimated by one task of the parallel ransac normal estimation
+   */
+  static const int RANSAC_BATCH_SIZE = 16;
 
   RasterToolPathPlanner::RasterToolPathPlanner(bool use_ransac):
-      use_ransac_normal_estimation_(use_ransac)
+      normal_estimation_(use_ransac ? RANSAC : NEAREST_NEIGHBORS),
+      num_threads_(1),
+      concurrent_sweeps_(false),
+      straight_rasters_(false),
+      max_rasters_(10),
+      share_input_mesh_(false),
+      record_on_(false),
+      collect_stats_(false),
+      stats_()
   {
     debug_on_ = false;
     cut_direction_[0] = cut_direction_[1] = cut_direction_[2] = 0;
     cut_centroid_[0] = cut_centroid_[1] = cut_centroid_[2] = 0;
   }
 
+  void RasterToolPathPlanner::setDebugMode(bool debug)
+  {
+#ifdef TOOL_PATH_PLANNER_HEADLESS
+    if(debug)
+    {
+      cout << "Debug mode is not available in headless builds\n";
+    }
+    debug_on_ = false;
+#else
+    debug_on_ = debug;
+#endif
+  }
+
+  void RasterToolPathPlanner::setDebugRecording(bool record)
+  {
+    record_on_ = record;
+    if(record_on_ && !debug_recorder_)
+    {
+      debug_recorder_.reset(new vtk_viewer::DebugRecorder());
+      debug_recorder_->setLogDir(log_dir_);
+    }
+  }
+
+  void RasterToolPathPlanner::setLogDir(std::string dir)
+  {
+    log_dir_ = dir;
+    if(debug_viewer_)
+    {
+      debug_viewer_->setLogDir(dir);
+    }
+    if(debug_recorder_)
+    {
+      debug_recorder_->setLogDir(dir);
+    }
+  }
+
+  void RasterToolPathPlanner::addStat(long& counter, long count)
+  {
+    if(collect_stats_)
+    {
+      std::lock_guard<std::mutex> lock(stats_mutex_);
+      counter += count;
+    }
+  }
+
+  void RasterToolPathPlanner::updateScratchStat(long bytes)
+  {
+    if(collect_stats_)
+    {
+      std::lock_guard<std::mutex> lock(stats_mutex_);
+      stats_.peak_scratch_bytes = std::max(stats_.peak_scratch_bytes, bytes);
+    }
+  }
+
+  void RasterToolPathPlanner::recordDebugData(vtkSmartPointer<vtkPolyData> data, const std::string& name)
+  {
+    if(record_on_ && data)
+    {
+      debug_recorder_->record(data, name);
+    }
+  }
+
+  vtk_viewer::VTKViewer& RasterToolPathPlanner::getDebugViewer()
+  {
+    if(!debug_viewer_)
+    {
+      debug_viewer_.reset(new vtk_viewer::VTKViewer());
+      debug_viewer_->setLogDir(log_dir_);
+      if(input_mesh_)
+      {
+        std::vector<float> color(3);
+        color[0] = 0.9; color[1] = 0.9; color[2] = 0.9;
+        debug_viewer_->addPolyDataDisplay(input_mesh_, color);
+      }
+    }
+    return *debug_viewer_;
+  }
+
   void RasterToolPathPlanner::planPaths(const vtkSmartPointer<vtkPolyData> mesh, std::vector<ProcessPath>& paths)
   {
+    vtk_viewer::TraceSpan span("RasterToolPathPlanner::planPaths");
     setInputMesh(mesh);
-    paths_.clear();
+    rasters_.clear();
     input_mesh_->BuildLinks();
     input_mesh_->BuildCells();
     computePaths();
     paths = getPaths();
   }
 
+  void RasterToolPathPlanner::planPaths(const vtkSmartPointer<vtkPolyData> mesh, std::vector<CompactPath>& paths)
+  {
+    vtk_viewer::TraceSpan span("RasterToolPathPlanner::planPaths");
+    setInputMesh(mesh);
+    rasters_.clear();
+    input_mesh_->BuildLinks();
+    input_mesh_->BuildCells();
+    computePaths();
+    paths = getCompactPaths();
+  }
+
+  std::vector<ProcessPath> RasterToolPathPlanner::getPaths()
+  {
+    std::vector<ProcessPath> paths;
+    paths.reserve(rasters_.size());
+    for(int i = 0; i < rasters_.size(); ++i)
+    {
+      paths.push_back(createProcessPath(rasters_[i]));
+    }
+    return paths;
+  }
+
+  std::vector<CompactPath> RasterToolPathPlanner::getCompactPaths()
+  {
+    std::vector<CompactPath> paths;
+    paths.reserve(rasters_.size());
+    for(int i = 0; i < rasters_.size(); ++i)
+    {
+      paths.push_back(rasters_[i].path);
+    }
+    return paths;
+  }
+
+  RasterToolPathPlanner::Raster RasterToolPathPlanner::createRaster(const ProcessPath& path)
+  {
+    Raster raster;
+    createCompactPath(path, raster.path);
+    raster.intersection_plane = path.intersection_plane;
+    raster.intersection = path.intersection;
+    return raster;
+  }
+
+  ProcessPath RasterToolPathPlanner::createProcessPath(const Raster& raster)
+  {
+    ProcessPath path;
+    tool_path_planner::createProcessPath(raster.path, path);
+    path.intersection_plane = raster.intersection_plane;
+    path.intersection = raster.intersection;
+    return path;
+  }
+
   void RasterToolPathPlanner::planPaths(const std::vector<vtkSmartPointer<vtkPolyData> > meshes, std::vector< std::vector<ProcessPath> >& paths)
   {
-    for(int i = 0; i < meshes.size(); ++i)
+    vtk_viewer::TraceSpan span("RasterToolPathPlanner::planPaths (meshes)");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    PlannerStats total_stats = PlannerStats();
+
+    // the debug viewer is not thread safe, always plan serially when debugging (or recording, so the recorded steps
+    // of the meshes do not interleave)
+    if(num_threads_ == 1 || meshes.size() < 2 || debug_on_ || record_on_)
+    {
+      for(int i = 0; i < meshes.size(); ++i)
+      {
+        std::vector<ProcessPath> new_path;
+        planPaths(meshes[i], new_path);
+        paths.push_back(new_path);
+        addStats(total_stats, stats_);
+      }
+
+      if(collect_stats_)
+      {
+        stats_ = total_stats;
+        stats_.total_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      }
+      return;
+    }
+
+    vtk_viewer::ThreadPool pool(std::min<int>(num_threads_ > 0 ? num_threads_ : vtk_viewer::ThreadPool::getHardwareThreads(),
+                                              meshes.size()));
+
+    // Every thread gets its own planner (input mesh, kd tree, paths) so no planning state is shared between threads.
+    // Debug mode plans serially, so none of these planners creates a debug viewer.
+    std::vector<std::unique_ptr<RasterToolPathPlanner> > planners;
+    for(int i = 0; i < pool.getNumThreads(); ++i)
+    {
+      planners.push_back(std::unique_ptr<RasterToolPathPlanner>(new RasterToolPathPlanner()));
+      planners.back()->setNormalEstimation(normal_estimation_);
+      planners.back()->setTool(tool_);
+      planners.back()->setCutDirection(cut_direction_);
+      planners.back()->setCutCentroid(cut_centroid_);
+      planners.back()->setConcurrentSweeps(concurrent_sweeps_);
+      planners.back()->setStraightRasters(straight_rasters_);
+      planners.back()->setMaxRasters(max_rasters_);
+      planners.back()->setShareInputMesh(share_input_mesh_);
+      planners.back()->setCollectStats(collect_stats_);
+    }
+
+    // results are stored by mesh index so the output order does not depend on how the tasks interleave
+    std::vector< std::vector<ProcessPath> > new_paths(meshes.size());
+    std::vector<PlannerStats> new_stats(meshes.size());
+    pool.parallelFor(meshes.size(), [&](int index, int thread_id)
+    {
+      planners[thread_id]->planPaths(meshes[index], new_paths[index]);
+      new_stats[index] = planners[thread_id]->getStats();
+    });
+
+    paths.insert(paths.end(), new_paths.begin(), new_paths.end());
+
+    if(collect_stats_)
     {
-      std::vector<ProcessPath> new_path;
-      planPaths(meshes[i], new_path);
-      paths.push_back(new_path);
+      for(int i = 0; i < new_stats.size(); ++i)
+      {
+        addStats(total_stats, new_stats[i]);
+      }
+      stats_ = total_stats;
+      stats_.total_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
     }
   }
 
   void RasterToolPathPlanner::planPaths(const std::vector<pcl::PolygonMesh>& meshes, std::vector< std::vector<ProcessPath> >& paths)
   {
+    std::vector<vtkSmartPointer<vtkPolyData> > vtk_meshes;
     for(int i = 0; i < meshes.size(); ++i)
     {
-      std::vector<ProcessPath> new_path;
-      planPaths(meshes[i], new_path);
-      paths.push_back(new_path);
+      vtkSmartPointer<vtkPolyData> vtk_mesh;
+      pcl::VTKUtils::mesh2vtk(meshes[i], vtk_mesh);
+      vtk_meshes.push_back(vtk_mesh);
     }
+    planPaths(vtk_meshes, paths);
   }
 
   void RasterToolPathPlanner::planPaths(const pcl::PolygonMesh& mesh, std::vector<ProcessPath>& paths)
@@ -88,11 +446,28 @@ namespace tool_path_planner
 
   void RasterToolPathPlanner::setInputMesh(vtkSmartPointer<vtkPolyData> mesh)
   {
+    vtk_viewer::TraceSpan span("RasterToolPathPlanner::setInputMesh");
+    stats_ = PlannerStats();
+    StageTimer total_timer(collect_stats_ ? &stats_.total_time : NULL, stats_mutex_);
+    StageTimer setup_timer(collect_stats_ ? &stats_.setup_time : NULL, stats_mutex_);
+
     if(!input_mesh_)
     {
       input_mesh_ = vtkSmartPointer<vtkPolyData>::New();
     }
-    input_mesh_->DeepCopy(mesh);
+    if(share_input_mesh_)
+    {
+      // the points, cell arrays and data arrays are referenced, attributes set below (normals) and the cell table
+      // belong to input_mesh_ only
+      input_mesh_->ShallowCopy(mesh);
+    }
+    else
+    {
+      input_mesh_->DeepCopy(mesh);
+    }
+    input_mesh_->BuildCells();  // cell lookups are read only after this, so sweeps may share the mesh
+    intersector_.setInputMesh(input_mesh_);
+    adjacency_.build(input_mesh_, num_threads_);
 
     if(!kd_tree_)
     {
@@ -101,11 +476,16 @@ namespace tool_path_planner
     kd_tree_->SetDataSet(input_mesh_);
     kd_tree_->BuildLocator();
 
-    // Add display for debugging
-    debug_viewer_.removeAllDisplays();
-    std::vector<float> color(3);
-    color[0] = 0.9; color[1] = 0.9; color[2] = 0.9;
-    debug_viewer_.addPolyDataDisplay(input_mesh_, color);
+    recordDebugData(input_mesh_, "input_mesh");
+
+    // Replace the mesh shown by the debug viewer, if one was created
+    if(debug_viewer_)
+    {
+      debug_viewer_->removeAllDisplays();
+      std::vector<float> color(3);
+      color[0] = 0.9; color[1] = 0.9; color[2] = 0.9;
+      debug_viewer_->addPolyDataDisplay(input_mesh_, color);
+    }
 
     // TODO: this does not appear to work
     vtk_viewer::generateNormals(input_mesh_);
@@ -113,106 +493,317 @@ namespace tool_path_planner
 
   bool RasterToolPathPlanner::computePaths()
   {
-    // Need to call getFirstPath or other method to generate the first path
-    // If no paths exist, there is nothing to create offset paths from
-    if(paths_.size() != 1)
+    vtk_viewer::TraceSpan span("RasterToolPathPlanner::computePaths");
+    StageTimer total_timer(collect_stats_ ? &stats_.total_time : NULL, stats_mutex_);
+
+    if(straight_rasters_)
     {
-      ProcessPath first_path;
-      if(!getFirstPath(first_path))
+      // every raster is a plane, slice all of them at once
+      if(!computeStraightRasters())
       {
         return false;
       }
     }
+    else
+    {
+      // Need to call getFirstPath or other method to generate the first path
+      // If no paths exist, there is nothing to create offset paths from
+      if(rasters_.size() != 1)
+      {
+        Raster first_raster;
+        if(!getFirstRaster(first_raster))
+        {
+          return false;
+        }
+      }
 
-    // could potentially make these two loops run in parallel but then we would need to add locks on the data
-    bool done = false;
-    int max = 10;
-    int count = 0;
+      int max = getSweepLimit();
 
-    // From existing cutting plane, create more offset planes in one direction
-    while(!done && count < max)
-    {
-      ProcessPath path2;
-      if(getNextPath(paths_.back(), path2, tool_.line_spacing))
+      if(concurrent_sweeps_ && !debug_on_)
       {
-        paths_.push_back(path2);
+        computeSweepsConcurrently(max);
       }
       else
       {
-        done = true;
+        bool done = false;
+        int count = 0;
+
+        // From existing cutting plane, create more offset planes in one direction
+        while(!done && count < max)
+        {
+          std::vector<vtkSmartPointer<vtkPolyData> > check_surfaces;
+          check_surfaces.push_back(rasters_.back().intersection_plane);
+          check_surfaces.push_back(rasters_.front().intersection_plane);
+
+          Raster raster2;
+          if(getNextRaster(rasters_.back(), raster2, tool_.line_spacing, check_surfaces))
+          {
+            rasters_.push_back(raster2);
+          }
+          else
+          {
+            done = true;
+          }
+          ++count;
+        }
+
+        // From existing cutting plane, create more offset planes in opposite direction.  The new rasters are collected
+        // and put in front of the others at the end, inserting each at the front of rasters_ would be quadratic.
+        std::vector<Raster> sweep;
+        count = 0;
+        done = false;
+        while(!done && count < max)
+        {
+          std::vector<vtkSmartPointer<vtkPolyData> > check_surfaces;
+          check_surfaces.push_back(rasters_.back().intersection_plane);
+          check_surfaces.push_back(sweep.empty() ? rasters_.front().intersection_plane : sweep.back().intersection_plane);
+
+          Raster raster2;
+          if(getNextRaster(sweep.empty() ? rasters_.front() : sweep.back(), raster2, -tool_.line_spacing, check_surfaces))
+          {
+            sweep.push_back(raster2);
+          }
+          else
+          {
+            done = true;
+          }
+          ++count;
+        }
+        rasters_.insert(rasters_.begin(), sweep.rbegin(), sweep.rend());
       }
-      ++count;
     }
 
-    // From existing cutting plane, create more offset planes in opposite direction
-    count = 0;
-    done = false;
-    while(!done && count < max)
+    // clear all but the first (mesh) display
+    if(debug_on_)
+    {
+      int num_obj = getDebugViewer().getNumberOfDisplayObjects() - 1;
+      for(int i = 0; i < num_obj; ++i)
+      getDebugViewer().removeObjectDisplay(getDebugViewer().getNumberOfDisplayObjects() - 1);
+    }
+
+
+    // rasters with holes are replaced by their pieces, which are added after all of the remaining rasters
+    std::vector<Raster> new_rasters;
+    std::vector<Raster> kept_rasters;
+    kept_rasters.reserve(rasters_.size());
+    for(int i = 0; i < rasters_.size(); ++i)
     {
-      ProcessPath path2;
-      if(getNextPath(paths_.front(), path2, -tool_.line_spacing))
+      std::vector<Raster> out_rasters;
+      if(checkPathForHoles(rasters_[i], out_rasters))
       {
-        paths_.insert(paths_.begin(), path2 );
+        for(int j = 0; j < out_rasters.size(); ++j)
+        {
+          new_rasters.push_back(out_rasters[j]); // save all new rasters
+        }
       }
       else
       {
-        done = true;
+        kept_rasters.push_back(rasters_[i]);
       }
-      ++count;
     }
+    rasters_.swap(kept_rasters);
 
-    // clear all but the first (mesh) display
-    if(debug_on_)
+    for(int i = 0; i < new_rasters.size(); ++i)
     {
-      int num_obj = debug_viewer_.getNumberOfDisplayObjects() - 1;
-      for(int i = 0; i < num_obj; ++i)
-      debug_viewer_.removeObjectDisplay(debug_viewer_.getNumberOfDisplayObjects() - 1);
+      rasters_.push_back(new_rasters[i]);
+      recordDebugData(new_rasters[i].intersection_plane, "split_cutting_surface");
+
+      if(debug_on_)  // cutting mesh display
+      {
+        std::vector<float> color(3);
+        color[0] = 0.8; color[1] = 0.8; color[2] = 0.8;
+
+        getDebugViewer().addPolyDataDisplay(new_rasters[i].intersection_plane, color);
+        getDebugViewer().renderDisplay();
+      }
     }
 
+    return true;
+  }
+
+  void RasterToolPathPlanner::computeSweepsConcurrently(int max)
+  {
+    // The two fronts only share the input mesh, its kd tree and the first path (all read only).  Each front tests its
+    // new paths for self intersection against its own last path and the first path, as the first sequential sweep
+    // does, so neither depends on how far the other front has come and both give the same paths on every run.
+    std::vector<Raster> sweeps[2];
+
+    vtk_viewer::ThreadPool pool(2);
+    pool.parallelFor(2, [&](int front, int)
+    {
+      double dist = (front == 0) ? tool_.line_spacing : -tool_.line_spacing;
+      Raster last_raster = rasters_.front();
+
+      for(int count = 0; count < max; ++count)
+      {
+        std::vector<vtkSmartPointer<vtkPolyData> > check_surfaces;
+        check_surfaces.push_back(last_raster.intersection_plane);
+        check_surfaces.push_back(rasters_.front().intersection_plane);
 
-    std::vector<ProcessPath> new_paths;
-    std::vector<int> delete_paths;
-    for(int i = 0; i < paths_.size(); ++i)
+        Raster next_raster;
+        if(!getNextRaster(last_raster, next_raster, dist, check_surfaces))
+        {
+          break;
+        }
+
+        sweeps[front].push_back(next_raster);
+        last_raster = next_raster;
+      }
+    });
+
+    // On closed surfaces the fronts run past each other.  They meet at the first pair of paths which intersect, in
+    // order of their combined distance from the first path (i + j), the first front keeps its path and the second
+    // front is cut before its own.  No earlier pair intersects, so none of the paths left cross each other.
+    int size0 = sweeps[0].size();
+    int size1 = sweeps[1].size();
+    bool met = false;
+    for(int sum = 0; sum <= size0 + size1 - 2 && !met; ++sum)
     {
-      std::vector<ProcessPath> out_paths;
-      if(checkPathForHoles(paths_[i], out_paths))
+      for(int i = std::max(0, sum - size1 + 1); i <= std::min(sum, size0 - 1); ++i)
       {
-        // mark a path to delete
-        delete_paths.push_back(i);
-        for(int j = 0; j < out_paths.size(); ++j)
+        int j = sum - i;
+        if(surfacesIntersect(sweeps[0][i].intersection_plane, sweeps[1][j].intersection_plane))
         {
-          new_paths.push_back(out_paths[j]); // save all new paths
+          sweeps[0].resize(i + 1);
+          sweeps[1].resize(j);
+          met = true;
+          break;
         }
       }
     }
 
-    // if paths need to be modified, delete all old paths (starting at the back) and insert new ones
-    for(int i = delete_paths.size() - 1; i >=0 ; --i )
+    // rasters are ordered the same as the sequential sweeps: second front (reversed), first raster, first front
+    rasters_.insert(rasters_.begin(), sweeps[1].rbegin(), sweeps[1].rend());
+    rasters_.insert(rasters_.end(), sweeps[0].begin(), sweeps[0].end());
+  }
+
+  int RasterToolPathPlanner::getSweepLimit()
+  {
+    if(max_rasters_ > 0)
     {
-      paths_.erase(paths_.begin() + delete_paths[i]);
+      return max_rasters_;
     }
 
-    for(int i = 0; i < new_paths.size(); ++i)
+    // no user limit, the sweeps stop when a path misses the mesh; as a guard against sweeps that never end, allow
+    // enough rasters to cross the mesh bounding box diagonal along a generously curved path
+    double bounds[6];
+    if(tool_.line_spacing <= 0.0 || !getPointBounds(input_mesh_, bounds))
     {
-      paths_.push_back(new_paths[i]);
+      return 0;
+    }
+    double diagonal = sqrt((bounds[1] - bounds[0]) * (bounds[1] - bounds[0]) +
+                           (bounds[3] - bounds[2]) * (bounds[3] - bounds[2]) +
+                           (bounds[5] - bounds[4]) * (bounds[5] - bounds[4]));
+    return int(std::ceil(vtkMath::Pi() * diagonal / tool_.line_spacing)) + 1;
+  }
 
-      if(debug_on_)  // cutting mesh display
+  bool RasterToolPathPlanner::computeStraightRasters()
+  {
+    rasters_.clear();
+
+    // the planes contain the start curve and its normal, and are offset along the normal of that plane
+    vtkSmartPointer<vtkPolyData> start_curve = createStartCurve();
+    double start[3], center[3], end[3], normal[3], plane_normal[3];
+    start_curve->GetPoints()->GetPoint(0, start);
+    start_curve->GetPoints()->GetPoint(1, center);
+    start_curve->GetPoints()->GetPoint(2, end);
+    start_curve->GetPointData()->GetNormals()->GetTuple(0, normal);
+    double direction[3] = {end[0] - start[0], end[1] - start[1], end[2] - start[2]};
+    vtkMath::Cross(direction, normal, plane_normal);
+    if(vtkMath::Normalize(plane_normal) == 0.0 || tool_.line_spacing <= 0.0)
+    {
+      cout << "Cannot create raster planes from the start curve\n";
+      return false;
+    }
+
+    // place the planes so that one goes through the center of the start curve and they cover the whole mesh
+    double min = std::numeric_limits<double>::max();
+    double max = -std::numeric_limits<double>::max();
+    vtkPoints* mesh_points = input_mesh_->GetPoints();
+    for(int i = 0; i < mesh_points->GetNumberOfPoints(); ++i)
+    {
+      double pt[3];
+      mesh_points->GetPoint(i, pt);
+      double height = vtkMath::Dot(plane_normal, pt);
+      min = std::min(min, height);
+      max = std::max(max, height);
+    }
+    double center_offset = vtkMath::Dot(plane_normal, center);
+    int first = int(std::ceil((min - center_offset) / tool_.line_spacing));
+    int last = int(std::floor((max - center_offset) / tool_.line_spacing));
+    if(last < first)
+    {
+      cout << "No intersection found\n";
+      return false;
+    }
+
+    std::vector<vtkSmartPointer<vtkPolyData> > lines;
+    {
+      StageTimer timer(collect_stats_ ? &stats_.intersection_time : NULL, stats_mutex_);
+      intersector_.slice(plane_normal, center_offset + first * tool_.line_spacing, tool_.line_spacing,
+                         last - first + 1, lines);
+    }
+    addStat(stats_.intersections, last - first + 1);
+
+    for(int i = 0; i < lines.size(); ++i)
+    {
+      if(lines[i]->GetNumberOfPoints() <= 1)
       {
-        std::vector<float> color(3);
-        color[0] = 0.8; color[1] = 0.8; color[2] = 0.8;
+        continue;
+      }
 
-        debug_viewer_.addPolyDataDisplay(new_paths[i].intersection_plane, color);
-        debug_viewer_.renderDisplay();
+      // find a continous line segment in the intersection
+      vtkSmartPointer<vtkPoints> line_points = vtkSmartPointer<vtkPoints>::New();
+      vtkSmartPointer<vtkIdTypeArray> cell_ids;
+      getConnectedIntersectionLine(lines[i], line_points, cell_ids);
+      if(line_points->GetNumberOfPoints() < 2)
+      {
+        continue;
+      }
+
+      vtkSmartPointer<vtkPolyData> intersection = vtkSmartPointer<vtkPolyData>::New();
+      intersection->SetPoints(line_points);
+      intersection->GetPointData()->AddArray(cell_ids);
+
+      Raster raster;
+      if(!createPath(intersection, raster))
+      {
+        continue;
+      }
+
+      // all paths run in the same direction as the previous one
+      if(!rasters_.empty())
+      {
+        const CompactPath& path = raster.path;
+        const double* this_start = &rasters_.back().path.points[0];
+        const double* next_start = &path.points[0];
+        const double* next_end = &path.points[path.points.size() - 3];
+        if(vtkMath::Distance2BetweenPoints(this_start, next_start) > vtkMath::Distance2BetweenPoints(this_start, next_end))
+        {
+          flipPointOrder(raster.path);
+        }
       }
+      rasters_.push_back(raster);
     }
 
-    return true;
+    return !rasters_.empty();
   }
 
   bool RasterToolPathPlanner::getFirstPath(ProcessPath& path)
+  {
+    Raster raster;
+    if(!getFirstRaster(raster))
+    {
+      return false;
+    }
+    path = createProcessPath(raster);
+    return true;
+  }
+
+  bool RasterToolPathPlanner::getFirstRaster(Raster& raster)
   {
     // clear old paths before creating new
-    paths_.clear();
+    rasters_.clear();
 
     // generate first path according to algorithm in createStartCurve()
     vtkSmartPointer<vtkPolyData> start_curve = vtkSmartPointer<vtkPolyData>::New();
@@ -230,15 +821,16 @@ namespace tool_path_planner
     max = max > z ? max : z;
 
     vtkSmartPointer<vtkPolyData> cutting_mesh = createSurfaceFromSpline(start_curve, max);
+    recordDebugData(cutting_mesh, "first_cutting_surface");
 
     if(debug_on_)  // cutting mesh display
     {
       std::vector<float> color(3);
       color[0] = 0.8; color[1] = 0.8; color[2] = 0.8;
 
-      debug_viewer_.addPolyDataDisplay(cutting_mesh, color);
-      debug_viewer_.renderDisplay();
-      debug_viewer_.removeObjectDisplay(debug_viewer_.getNumberOfDisplayObjects() - 1);
+      getDebugViewer().addPolyDataDisplay(cutting_mesh, color);
+      getDebugViewer().renderDisplay();
+      getDebugViewer().removeObjectDisplay(getDebugViewer().getNumberOfDisplayObjects() - 1);
     }
 
     // use cutting mesh to find intersection line
@@ -251,89 +843,121 @@ namespace tool_path_planner
       return false;
     }
 
-    ProcessPath this_path;
-    estimateNewNormals(intersection_line);
-    this_path.intersection_plane = intersection_line;
-
-    if(getNextPath(this_path, path, 0.0))
+    // the intersection already lies on the mesh, create the path from it instead of intersecting again
+    if(createPath(intersection_line, raster))
     {
-      paths_.push_back(path);
+      rasters_.push_back(raster);
       return true;
     }
     return false;
   }
 
+  bool RasterToolPathPlanner::createPath(vtkSmartPointer<vtkPolyData> intersection, Raster& raster)
+  {
+    if(intersection->GetPoints()->GetNumberOfPoints() < 2)
+    {
+      return false;
+    }
+
+    //use spline to create interpolated data with normals and derivatives
+    smoothData(intersection, raster.path);
+    if(raster.path.size() < 2)
+    {
+      cout << "Number of points after smoothing is less than 2\n";
+      return false;
+    }
+
+    raster.intersection = intersection;
+    raster.intersection_plane = createSurfaceFromSpline(raster.path.points, raster.path.normals,
+                                                        tool_.intersecting_plane_height);
+    return true;
+  }
+
   bool RasterToolPathPlanner::getNextPath(const ProcessPath this_path, ProcessPath& next_path, double dist, bool test_self_intersection)
   {
-    if(dist == 0.0 && this_path.intersection_plane->GetPoints()->GetNumberOfPoints() < 2)
+    // Check for self intersection (intersection of next path with the last path computed and the first path)
+    std::vector<vtkSmartPointer<vtkPolyData> > check_surfaces;
+    if(test_self_intersection && rasters_.size() >= 1)
+    {
+      check_surfaces.push_back(rasters_.back().intersection_plane);
+      check_surfaces.push_back(rasters_.front().intersection_plane);
+    }
+
+    Raster next_raster;
+    if(!getNextRaster(createRaster(this_path), next_raster, dist, check_surfaces))
+    {
+      return false;
+    }
+    next_path = createProcessPath(next_raster);
+    return true;
+  }
+
+  bool RasterToolPathPlanner::getNextRaster(const Raster& this_raster, Raster& next_raster, double dist,
+                                            const std::vector<vtkSmartPointer<vtkPolyData> >& check_surfaces)
+  {
+    vtk_viewer::TraceSpan span("RasterToolPathPlanner::getNextRaster");
+    if(dist == 0.0 && this_raster.intersection_plane->GetPoints()->GetNumberOfPoints() < 2)
     {
       cout << "No path offset and no intersection plane given. Cannot generate next path\n";
       return false;
     }
+    if(dist != 0.0 && this_raster.path.size() < 2)
+    {
+      cout << "No path points given. Cannot generate next path\n";
+      return false;
+    }
 
     vtkSmartPointer<vtkPolyData> offset_line = vtkSmartPointer<vtkPolyData>::New();
     if(dist != 0.0)  // if offset distance given, create an offset surface
     {
       // create offset points
-      offset_line = createOffsetLine(this_path.line, this_path.derivatives, dist);
+      offset_line = createOffsetLine(this_raster.path, dist);
 
       // create cutting surface  TODO: offset may need to be based upon point bounds
-      next_path.intersection_plane = createSurfaceFromSpline(offset_line, tool_.intersecting_plane_height);
+      next_raster.intersection_plane = createSurfaceFromSpline(offset_line, tool_.intersecting_plane_height);
     }
-    else  // if no offset distance given, use points in this_path.intersection_plane to create the surface
+    else  // if no offset distance given, use points in this_raster.intersection_plane to create the surface
     {
       // resample points to make sure there the intersection filter works properly
       vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
-      points = this_path.intersection_plane->GetPoints();
+      points = this_raster.intersection_plane->GetPoints();
       resamplePoints(points);
       offset_line->SetPoints(points);
       estimateNewNormals(offset_line);
 
-      next_path.intersection_plane = createSurfaceFromSpline(offset_line, tool_.intersecting_plane_height);
+      next_raster.intersection_plane = createSurfaceFromSpline(offset_line, tool_.intersecting_plane_height);
     }
+    recordDebugData(offset_line, "offset_line");
+    recordDebugData(next_raster.intersection_plane, "cutting_surface");
 
     if(debug_on_)  // offset points and cutting mesh display
     {
       std::vector<float> color(3);
       color[0] = 0.9; color[1] = 0.2; color[2] = 0.2;
-      debug_viewer_.addPolyNormalsDisplay(offset_line, color, tool_.pt_spacing);
+      getDebugViewer().addPolyNormalsDisplay(offset_line, color, tool_.pt_spacing);
 
       color[0] = 0.8; color[1] = 0.8; color[2] = 0.8;
-      debug_viewer_.addPolyDataDisplay(next_path.intersection_plane, color);
-      debug_viewer_.renderDisplay();
-      debug_viewer_.removeObjectDisplay(debug_viewer_.getNumberOfDisplayObjects() - 2);
+      getDebugViewer().addPolyDataDisplay(next_raster.intersection_plane, color);
+      getDebugViewer().renderDisplay();
+      getDebugViewer().removeObjectDisplay(getDebugViewer().getNumberOfDisplayObjects() - 2);
     }
 
     // use surface to find intersection line
     vtkSmartPointer<vtkPolyData> intersection_line = vtkSmartPointer<vtkPolyData>::New();
     vtkSmartPointer<vtkParametricSpline> spline = vtkSmartPointer<vtkParametricSpline>::New();
 
-    if(!findIntersectionLine(next_path.intersection_plane, intersection_line, spline))
+    if(!findIntersectionLine(next_raster.intersection_plane, intersection_line, spline))
     {
       cout << "No intersection found for creating spline\n";
       return false;
     }
+    next_raster.intersection = intersection_line;
 
-    // Check for self intersection (intersection of next path with the last path computed
+    // Check for self intersection with previously computed paths
     // If self-intersection occurs, return false (done planning paths)
-    if(test_self_intersection && paths_.size() >= 1)
-    {
-      vtkSmartPointer<vtkIntersectionPolyDataFilter> intersection_filter =
-        vtkSmartPointer<vtkIntersectionPolyDataFilter>::New();
-      intersection_filter->SetSplitFirstOutput(0);
-      intersection_filter->SetSplitSecondOutput(0);
-      intersection_filter->SetInputData( 0, next_path.intersection_plane);
-      intersection_filter->SetInputData( 1, paths_.back().intersection_plane);
-      intersection_filter->Update();
-      if(intersection_filter->GetOutput()->GetPoints()->GetNumberOfPoints() > 0)
-      {
-        cout << "Self intersection found\n";
-        return false;
-      }
-
-      intersection_filter->SetInputData( 1, paths_.front().intersection_plane);
-      intersection_filter->Update();
-      if(intersection_filter->GetOutput()->GetPoints()->GetNumberOfPoints() > 0)
+    for(int i = 0; i < check_surfaces.size(); ++i)
+    {
+      if(surfacesIntersect(next_raster.intersection_plane, check_surfaces[i]))
       {
         cout << "Self intersection found\n";
         return false;
@@ -341,196 +965,183 @@ namespace tool_path_planner
     }
 
 
-    if(debug_on_)  // spline display
+    if(debug_on_ || record_on_)  // spline display
     {
       std::vector<float> color(3);
       color[0] = 0.2; color[1] = 0.9; color[2] = 0.9;
       vtkSmartPointer<vtkParametricFunctionSource> source = vtkSmartPointer<vtkParametricFunctionSource>::New();
       source->SetParametricFunction(spline);
       source->Update();
+      recordDebugData(source->GetOutput(), "spline");
 
-      debug_viewer_.addPolyDataDisplay(source->GetOutput(), color);
-      debug_viewer_.renderDisplay();
-      debug_viewer_.removeObjectDisplay(debug_viewer_.getNumberOfDisplayObjects() - 1);
+      if(debug_on_)
+      {
+        getDebugViewer().addPolyDataDisplay(source->GetOutput(), color);
+        getDebugViewer().renderDisplay();
+        getDebugViewer().removeObjectDisplay(getDebugViewer().getNumberOfDisplayObjects() - 1);
+      }
     }
 
     //use spline to create interpolated data with normals and derivatives
-    vtkSmartPointer<vtkPolyData> points = vtkSmartPointer<vtkPolyData>::New();
-    vtkSmartPointer<vtkPolyData> derivatives = vtkSmartPointer<vtkPolyData>::New();
-    smoothData(spline, points, derivatives);
+    CompactPath& next_path = next_raster.path;
+    smoothData(intersection_line, next_path);
 
     if(debug_on_)  // points display
     {
+      ProcessPath display = createProcessPath(next_raster);
       std::vector<float> color(3);
       color[0] = 0.2; color[1] = 0.2; color[2] = 0.9;
-      debug_viewer_.addPolyNormalsDisplay(points, color, tool_.pt_spacing);
+      getDebugViewer().addPolyNormalsDisplay(display.line, color, tool_.pt_spacing);
       color[0] = 0.9; color[1] = 0.9; color[2] = 0.2;
-      debug_viewer_.addPolyNormalsDisplay(derivatives, color, tool_.pt_spacing);
-      debug_viewer_.renderDisplay();
-      debug_viewer_.removeObjectDisplay(debug_viewer_.getNumberOfDisplayObjects() - 1);
+      getDebugViewer().addPolyNormalsDisplay(display.derivatives, color, tool_.pt_spacing);
+      getDebugViewer().renderDisplay();
+      getDebugViewer().removeObjectDisplay(getDebugViewer().getNumberOfDisplayObjects() - 1);
     }
 
-    if(points->GetPoints()->GetNumberOfPoints() < 2)
+    if(next_path.size() < 2)
     {
       cout << "Number of points after smoothing is less than 2\n";
       return false;
     }
-    next_path.line = points;
-    next_path.spline = spline;
-    next_path.derivatives = derivatives;
 
     // compare start/end points of new line to old line, flip order if necessary
     if(dist != 0.0)  // only flip if offset is non-zero (new_path)
     {
-      int length = next_path.line->GetPoints()->GetNumberOfPoints();
-      if(vtk_viewer::pt_dist(this_path.line->GetPoints()->GetPoint(0), next_path.line->GetPoints()->GetPoint(0))
-         > vtk_viewer::pt_dist(this_path.line->GetPoints()->GetPoint(0), next_path.line->GetPoints()->GetPoint(length-1)))
+      const double* this_start = &this_raster.path.points[0];
+      const double* next_start = &next_path.points[0];
+      const double* next_end = &next_path.points[next_path.points.size() - 3];
+      if(vtkMath::Distance2BetweenPoints(this_start, next_start) > vtkMath::Distance2BetweenPoints(this_start, next_end))
       {
         flipPointOrder(next_path);
       }
     }
 
-    if(debug_on_)  // points display
+    if(debug_on_ || record_on_)  // points display
     {
-      std::vector<float> color(3);
-      color[0] = 0.9; color[1] = 0.9; color[2] = 0.2;
-      debug_viewer_.addPolyNormalsDisplay(derivatives, color, tool_.pt_spacing);
-      debug_viewer_.renderDisplay();
+      ProcessPath display = createProcessPath(next_raster);
+      recordDebugData(display.line, "path");
+      recordDebugData(display.derivatives, "derivatives");
+
+      if(debug_on_)
+      {
+        std::vector<float> color(3);
+        color[0] = 0.9; color[1] = 0.9; color[2] = 0.2;
+        getDebugViewer().addPolyNormalsDisplay(display.derivatives, color, tool_.pt_spacing);
+        getDebugViewer().renderDisplay();
+      }
     }
 
     return true;
   }
 
-  bool RasterToolPathPlanner::checkPathForHoles(const ProcessPath path, std::vector<ProcessPath>& out_paths)
+  bool RasterToolPathPlanner::checkPathForHoles(const Raster& raster, std::vector<Raster>& out_rasters)
   {
-    // use cutting mesh to find intersection line
-    vtkSmartPointer<vtkPolyData> intersection_line = vtkSmartPointer<vtkPolyData>::New();
-    vtkSmartPointer<vtkParametricSpline> spline = vtkSmartPointer<vtkParametricSpline>::New();
+    // use the intersection found when the raster was created, only intersect the cutting mesh if it is not available
+    vtkSmartPointer<vtkPolyData> intersection_line = raster.intersection;
+    if(!intersection_line)
+    {
+      intersection_line = vtkSmartPointer<vtkPolyData>::New();
+      vtkSmartPointer<vtkParametricSpline> spline = vtkSmartPointer<vtkParametricSpline>::New();
+      if(!findIntersectionLine(raster.intersection_plane, intersection_line, spline))
+      {
+        return false;
+      }
+    }
 
-    if(!findIntersectionLine(path.intersection_plane, intersection_line, spline))
+    vtkIdTypeArray* cell_ids = vtkIdTypeArray::SafeDownCast(intersection_line->GetPointData()->GetArray(MESH_CELL_IDS));
+    if(!cell_ids)
     {
       return false;
     }
 
-    // create cell and triangle filters
-    vtkSmartPointer<vtkCellLocator> locator = vtkSmartPointer<vtkCellLocator>::New();
-    locator->SetDataSet(input_mesh_);
-    locator->BuildLocator();
-
-    int prev_start_point = 0;
-
-    // For each point on the intersection line, check to see if the points share a common triangle/cell.
-    // If they share a cell, there is no hole, if they don't share a cell, then there is a hole and the
-    // distance between the two points should be checked to see how large the hole is
-    for(int i = 1; i < intersection_line->GetPoints()->GetNumberOfPoints() - 1; ++i)
+    // the intersection line is split at these points, the pieces are smoothed after all holes are found
+    std::vector<int> breaks;
     {
-      // get two adjacent points
-      double pt1[3], pt2[3], pcoords[3];
-      double weights[3] = {0,0,0};
-      intersection_line->GetPoints()->GetPoint(i-1, pt1);
-      intersection_line->GetPoints()->GetPoint(i, pt2);
-
-      // calculate the distance between each point
-      double diff[3] = {pt2[0] - pt1[0], pt2[1] - pt1[1], pt2[2] - pt1[2]};
-
-      // move each point by a small amount towards each other
-      diff[0] *= 0.1;
-      diff[1] *= 0.1;
-      diff[2] *= 0.1;
-
-      pt1[0] += diff[0];
-      pt1[1] += diff[1];
-      pt1[2] += diff[2];
-
-      pt2[0] -= diff[0];
-      pt2[1] -= diff[1];
-      pt2[2] -= diff[2];
-
-      vtkSmartPointer<vtkGenericCell> cell = vtkSmartPointer<vtkGenericCell>::New();
-      vtkIdType cell1, cell2;
-
-      bool continous = false;
-      double tol = sqrt(diff[0] * diff[0] + diff[1] * diff[1] + diff[2] * diff[2]);
-
-      // find the cell that each point lies on
-      cell1 = locator->FindCell(pt1, tol, cell, pcoords, &weights[0]);
-      if(cell1 != -1)
-      {
-        cell2 = locator->FindCell(pt2, tol, cell, pcoords, &weights[0]);
-        if(cell2 != -1)
-        {
-          // if the cell for point 1 == the cell for point 2, then there is no hole
-          if(cell1 == cell2)
-          {
-            continous = true;
-          }
-        }
-      }
-
-      // If a hole is found, the current path needs to be broken up, create new path from previous start point
-      // to current point (i) in the intersection path
-      if(!continous)
+      StageTimer timer(collect_stats_ ? &stats_.hole_check_time : NULL, stats_mutex_);
+
+      // Each point on the intersection line knows the mesh cell of the segment to the next point, the point lies on
+      // it.  The last point of a stitched line has no such segment and lies on the cell of the segment from the
+      // previous point.  Consecutive points on the same cell are connected on the mesh.  Where the line leaves the
+      // mesh at a boundary edge and enters it again at another one (both points on boundary edges of different cells),
+      // there is a hole and the distance between the two points should be checked to see how large the hole is
+      for(int i = 1; i < intersection_line->GetPoints()->GetNumberOfPoints() - 1; ++i)
       {
-        // if no shared cell found, check distance and whether or not the path needs to be split
+        // get two adjacent points
+        double pt1[3], pt2[3];
         intersection_line->GetPoints()->GetPoint(i-1, pt1);
         intersection_line->GetPoints()->GetPoint(i, pt2);
-        double dist = sqrt(vtk_viewer::pt_dist(&pt1[0], &pt2[0]));
-
-        // split paths if hole is too large
-        if(dist > tool_.min_hole_size)
+        vtkIdType cell1 = cell_ids->GetValue(i-1);
+        vtkIdType cell2 = cell_ids->GetValue(i);
+        if(cell1 < 0 && i > 1)
         {
-          vtkSmartPointer<vtkIdList> ids = vtkSmartPointer<vtkIdList>::New();
-          // create new path from prev_start_point to current i
-          for(int j = prev_start_point; j < i; ++j)
-          {
-            ids->InsertNextId(j);
-          }
+          cell1 = cell_ids->GetValue(i-2);
+        }
 
-          vtkSmartPointer<vtkPolyData> new_line = vtkSmartPointer<vtkPolyData>::New();
-          vtkSmartPointer<vtkPoints> new_points = vtkSmartPointer<vtkPoints>::New();
-          intersection_line->GetPoints()->GetPoints(ids, new_points);
-          resamplePoints(new_points);
-          new_line->SetPoints(new_points);
+        bool continous = cell1 == cell2 || !isOnBoundary(pt1, cell1) || !isOnBoundary(pt2, cell2);
 
-          ProcessPath this_path, new_path;
-          estimateNewNormals(new_line);
-          this_path.intersection_plane = new_line;
+        // If a hole is found, the current path needs to be broken up at the current point (i) in the intersection path
+        if(!continous)
+        {
+          // if the line crosses a hole, check distance and whether or not the path needs to be split
+          double dist = sqrt(vtk_viewer::pt_dist(&pt1[0], &pt2[0]));
 
-          if(getNextPath(this_path, new_path, 0.0, false))
+          // split paths if hole is too large
+          if(dist > tool_.min_hole_size)
           {
-            out_paths.push_back(new_path);
+            breaks.push_back(i);
           }
-          prev_start_point = i;
         }
       }
     }
 
-    // once done looping, make last path (if a break occured)
-    if(prev_start_point > 0)
+    // create a new raster from every break (and the start of the line) to the next break (or the end of the line)
+    if(!breaks.empty())
     {
-      vtkSmartPointer<vtkIdList> ids = vtkSmartPointer<vtkIdList>::New();
-      for(int j = prev_start_point; j < intersection_line->GetPoints()->GetNumberOfPoints(); ++j)
+      breaks.insert(breaks.begin(), 0);
+      breaks.push_back(intersection_line->GetPoints()->GetNumberOfPoints());
+      for(int i = 0; i + 1 < breaks.size(); ++i)
       {
-        ids->InsertNextId(j);
+        Raster new_raster;
+        if(createPath(extractPoints(intersection_line, breaks[i], breaks[i + 1]), new_raster))
+        {
+          out_rasters.push_back(new_raster);
+        }
       }
-      vtkSmartPointer<vtkPolyData> new_line = vtkSmartPointer<vtkPolyData>::New();
-      vtkSmartPointer<vtkPoints> new_points = vtkSmartPointer<vtkPoints>::New();
-      intersection_line->GetPoints()->GetPoints(ids, new_points);
-      resamplePoints(new_points);
-      new_line->SetPoints(new_points);
+    }
+
+    return out_rasters.size() >= 1;
+
+  }
 
-      ProcessPath this_path, new_path;
-      estimateNewNormals(new_line);
-      this_path.intersection_plane = new_line;
+  bool RasterToolPathPlanner::isOnBoundary(const double pt[3], vtkIdType cell)
+  {
+    if(cell < 0 || cell >= adjacency_.getNumberOfCells())
+    {
+      return false;
+    }
 
-      if(getNextPath(this_path, new_path, 0.0, false))
+    const vtkIdType* edges = adjacency_.getBoundaryEdges(cell);
+    for(vtkIdType i = 0; i < adjacency_.getNumberOfBoundaryEdges(cell); ++i)
+    {
+      // distance from the point to the edge, relative to the edge length
+      double a[3], b[3];
+      input_mesh_->GetPoints()->GetPoint(edges[2 * i], a);
+      input_mesh_->GetPoints()->GetPoint(edges[2 * i + 1], b);
+      double edge[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+      double v[3] = {pt[0] - a[0], pt[1] - a[1], pt[2] - a[2]};
+      double length2 = vtkMath::Dot(edge, edge);
+      if(length2 == 0.0)
+      {
+        continue;
+      }
+      double t = std::max(0.0, std::min(1.0, vtkMath::Dot(v, edge) / length2));
+      double closest[3] = {a[0] + edge[0] * t, a[1] + edge[1] * t, a[2] + edge[2] * t};
+      if(vtkMath::Distance2BetweenPoints(pt, closest) <= 1e-12 * length2)
       {
-        out_paths.push_back(new_path);
+        return true;
       }
     }
-
-    return out_paths.size() >= 1;
-
+    return false;
   }
 
   vtkSmartPointer<vtkPolyData> RasterToolPathPlanner::createStartCurve()
@@ -697,300 +1308,285 @@ namespace tool_path_planner
       return false;
     }
 
-    // Find the intersection between the input mesh and given cutting surface
-    vtkSmartPointer<vtkIntersectionPolyDataFilter> intersection_filter =
-      vtkSmartPointer<vtkIntersectionPolyDataFilter>::New();
-    intersection_filter->SetSplitFirstOutput(0);
-    intersection_filter->SetSplitSecondOutput(0);
-    intersection_filter->SetInputData( 0, input_mesh_);
-    intersection_filter->SetInputData( 1, cut_surface );
-    intersection_filter->GlobalWarningDisplayOff();
-
-    intersection_filter->Update();
+    StageTimer timer(collect_stats_ ? &stats_.intersection_time : NULL, stats_mutex_);
+    addStat(stats_.intersections, 1);
 
-    // Check output of intersection to see if it is valid
-    vtkSmartPointer<vtkPolyData> output = intersection_filter->GetOutput();
-    if(!output)
-    {
-      return false;
-    }
+    // Find the intersection between the input mesh and given cutting surface
+    vtkSmartPointer<vtkPolyData> poly_data;
+    intersector_.intersect(cut_surface, poly_data);
 
     // if no intersection found, return false
-    vtkSmartPointer<vtkPoints> pts = intersection_filter->GetOutput()->GetPoints();
-    if(intersection_filter->GetStatus() == 0 || !pts || pts->GetNumberOfPoints() <= 1)
+    if(poly_data->GetNumberOfPoints() <= 1)
     {
       return false;
     }
 
+    // find a continous line segment in the intersection
     vtkSmartPointer<vtkPoints> temp_pts = vtkSmartPointer<vtkPoints>::New();
-    vtkSmartPointer<vtkPolyData> poly_data = vtkSmartPointer<vtkPolyData>::New();
-
-    // get the intersection filter output and find a continous line segment
-    poly_data = intersection_filter->GetOutput();
-    getConnectedIntersectionLine(poly_data, temp_pts);
+    vtkSmartPointer<vtkIdTypeArray> cell_ids;
+    getConnectedIntersectionLine(poly_data, temp_pts, cell_ids);
 
     // return points and spline
     points->SetPoints(temp_pts);
+    points->GetPointData()->AddArray(cell_ids);
     spline->SetPoints(temp_pts);
 
     return true;
 
   }
 
-  void RasterToolPathPlanner::getConnectedIntersectionLine(vtkSmartPointer<vtkPolyData> line, vtkSmartPointer<vtkPoints>& points)
+  void RasterToolPathPlanner::getConnectedIntersectionLine(vtkSmartPointer<vtkPolyData> line, vtkSmartPointer<vtkPoints>& points,
+                                                           vtkSmartPointer<vtkIdTypeArray>& cell_ids)
   {
-    int start = 0;
-    std::vector<int> used_ids;
-    std::vector<vtkSmartPointer<vtkPoints> > lines;
-    int num_points = line->GetNumberOfPoints();
-
-    while(used_ids.size() < num_points)
+    vtkIdType num_points = line->GetNumberOfPoints();
+    cell_ids = vtkSmartPointer<vtkIdTypeArray>::New();
+    cell_ids->SetName(MESH_CELL_IDS);
+
+    // undirected point adjacency built from the line cells, the neighbors of point i are
+    // neighbors[offsets[i], offsets[i + 1]) and are connected to it by a segment on mesh cell neighbor_cells[...]
+    std::vector<vtkIdType> offsets(num_points + 1, 0);
+    std::vector<vtkIdType> neighbors;
+    std::vector<vtkIdType> neighbor_cells;
+    vtkIdTypeArray* line_cell_ids = vtkIdTypeArray::SafeDownCast(line->GetCellData()->GetArray(MESH_CELL_IDS));
+    vtkCellArray* line_data = line->GetLines();
+    const vtkIdType* cells = line_data ? line_data->GetPointer() : NULL;
+    const vtkIdType* cells_end = cells ? cells + line_data->GetNumberOfConnectivityEntries() : NULL;
+    for(const vtkIdType* cell = cells; cell < cells_end; cell += *cell + 1)
     {
-      for(int i = 0; i < num_points; ++i)
+      for(vtkIdType i = 1; i < *cell; ++i)
       {
-        // if id 'i' is not found, use it as the next index to start with for finding connected lines
-        if(std::find(used_ids.begin(), used_ids.end(), i) == used_ids.end())
-        {
-          start = i;
-          break;
-        }
+        ++offsets[cell[i] + 1];
+        ++offsets[cell[i + 1] + 1];
+      }
+    }
+    for(vtkIdType i = 0; i < num_points; ++i)
+    {
+      offsets[i + 1] += offsets[i];
+    }
+    neighbors.resize(offsets.back());
+    neighbor_cells.resize(offsets.back());
+    std::vector<vtkIdType> next_neighbor(offsets.begin(), offsets.end() - 1);
+    vtkIdType cell_index = 0;
+    for(const vtkIdType* cell = cells; cell < cells_end; cell += *cell + 1, ++cell_index)
+    {
+      vtkIdType mesh_cell = line_cell_ids ? line_cell_ids->GetValue(cell_index) : -1;
+      for(vtkIdType i = 1; i < *cell; ++i)
+      {
+        neighbor_cells[next_neighbor[cell[i]]] = mesh_cell;
+        neighbors[next_neighbor[cell[i]]++] = cell[i + 1];
+        neighbor_cells[next_neighbor[cell[i + 1]]] = mesh_cell;
+        neighbors[next_neighbor[cell[i + 1]]++] = cell[i];
       }
-      vtkSmartPointer<vtkPoints> temp_points = vtkSmartPointer<vtkPoints>::New();
+    }
 
-      // only add the line segment if it is large enough
-      double dist = getConnectedIntersectionLine(line, temp_points, used_ids, start);
+    // only keep the line segments which are large enough
+    std::vector<bool> visited(num_points, false);
+    std::vector<std::deque<vtkIdType> > lines;
+    for(vtkIdType i = 0; i < num_points; ++i)
+    {
+      if(visited[i])
+      {
+        continue;
+      }
+      std::deque<vtkIdType> ids;
+      double dist = getConnectedIntersectionLine(line, offsets, neighbors, visited, i, ids);
       if( dist > tool_.min_segment_size)
       {
-        lines.push_back(temp_points);
+        lines.push_back(ids);
       }
     }
 
-    // Now that we have 1 or more lines, check to see if we need to merge/delete lines
-    if(lines.size() == 1)
+    if(lines.empty())
     {
-      points = lines[0];  // if only one line, return it
+      return;
     }
-    else if(lines.size() > 1)
+
+    // start with the largest line
+    int index = 0;
+    for(int i = 1; i < lines.size(); ++i)
     {
-      // check ends of each line for merging/deleting
-      vtkSmartPointer<vtkPoints> temp_points = vtkSmartPointer<vtkPoints>::New();
-      // find largest line to start with
-      int size = 0;
-      int index = 0;
-      for(int i = 0; i < lines.size(); ++i)
+      if(lines[i].size() > lines[index].size())
       {
-        if(lines[i]->GetNumberOfPoints() > size)
-        {
-          index = i;
-          size = lines[i]->GetNumberOfPoints();
-        }
+        index = i;
       }
-      temp_points = lines[index];
-      lines.erase(lines.begin() + index);
+    }
+    std::deque<vtkIdType> connected = lines[index];
 
-      while(lines.size() > 0)
+    if(lines.size() > 1)
+    {
+      // index the end points of all lines (line i has end points 2i and 2i + 1) to find the closest one to either end
+      // of the connected line without comparing against every line
+      vtkSmartPointer<vtkPoints> end_points = vtkSmartPointer<vtkPoints>::New();
+      end_points->SetDataTypeToDouble();
+      for(int i = 0; i < lines.size(); ++i)
       {
-        int next_index = 0;
-        int order = 0;
-        double min_dist = std::numeric_limits<float>::max();
-
-        // find the next closest line
-        for(int i = 0; i < lines.size(); ++i)
-        {
-          // get distance
-          double dist1 = vtk_viewer::pt_dist(temp_points->GetPoint(0), lines[i]->GetPoint(0));
-          double dist2 = vtk_viewer::pt_dist(temp_points->GetPoint( temp_points->GetNumberOfPoints() - 1 ), lines[i]->GetPoint(0) );
-          double dist3 = vtk_viewer::pt_dist(temp_points->GetPoint(0), lines[i]->GetPoint(lines[i]->GetNumberOfPoints() - 1) );
-          double dist4 = vtk_viewer::pt_dist(temp_points->GetPoint( temp_points->GetNumberOfPoints() - 1 ), lines[i]->GetPoint(lines[i]->GetNumberOfPoints() - 1) );
-
-
-          double dist = std::min(dist1, dist2);
-          dist = std::min(dist, dist3);
-          dist = std::min(dist, dist4);
-
-          // store distance and index if it is the smallest
-          // also store the order, used for later concatenation (front->front, back->front, front->back, back->back)
-          if(dist < min_dist)
-          {
-            next_index = i;
-            min_dist = dist;
-            order = (dist1 == min_dist) ? 1 : order;
-            order = (dist2 == min_dist) ? 2 : order;
-            order = (dist3 == min_dist) ? 3 : order;
-            order = (dist4 == min_dist) ? 4 : order;
-          }
-        }
-
-        // Use new index to append lines together or delete lines
-        // VTK does not support inserting new points at the front so sometimes we need to create a new object to insert points to
-        switch (order)
-        {
-        case 1:
-        {
-          vtkSmartPointer<vtkPoints> tmp = vtkSmartPointer<vtkPoints>::New();
-
-          for(int i = lines[next_index]->GetNumberOfPoints() - 1 ; i >=0 ; --i)
-          {
-            double pt[3];
-            lines[next_index]->GetPoint(i, pt);
-            tmp->InsertNextPoint(pt);
-          }
-          for(int i = 0; i < temp_points->GetNumberOfPoints(); ++i)
-          {
-            double pt[3];
-            temp_points->GetPoint(i, pt);
-            tmp->InsertNextPoint(pt);
-          }
-          temp_points->SetNumberOfPoints(tmp->GetNumberOfPoints());
-          temp_points->DeepCopy(tmp);
-          break;
-        }
-        case 2:
+        double pt[3];
+        line->GetPoint(lines[i].front(), pt);
+        end_points->InsertNextPoint(pt);
+        line->GetPoint(lines[i].back(), pt);
+        end_points->InsertNextPoint(pt);
+      }
+      vtkSmartPointer<vtkPolyData> end_data = vtkSmartPointer<vtkPolyData>::New();
+      end_data->SetPoints(end_points);
+      vtkSmartPointer<vtkKdTreePointLocator> locator = vtkSmartPointer<vtkKdTreePointLocator>::New();
+      locator->SetDataSet(end_data);
+      locator->BuildLocator();
+
+      std::vector<bool> used(lines.size(), false);
+      used[index] = true;
+      vtkSmartPointer<vtkIdList> found = vtkSmartPointer<vtkIdList>::New();
+      for(int remaining = lines.size() - 1; remaining > 0; --remaining)
+      {
+        // find the closest unused end point to each end of the connected line, growing the search until one is found
+        vtkIdType best[2] = {-1, -1};
+        double best_dist[2];
+        for(int side = 0; side < 2; ++side)
         {
-          for(int i = 0; i < lines[next_index]->GetNumberOfPoints(); ++i)
+          double pt[3];
+          line->GetPoint(side == 0 ? connected.front() : connected.back(), pt);
+          for(int n = std::min<int>(4, end_points->GetNumberOfPoints()); best[side] < 0; n *= 2)
           {
-            temp_points->InsertNextPoint(lines[next_index]->GetPoint(i));
+            n = std::min<int>(n, end_points->GetNumberOfPoints());
+            locator->FindClosestNPoints(n, pt, found);
+            for(vtkIdType i = 0; i < found->GetNumberOfIds(); ++i)
+            {
+              if(!used[found->GetId(i) / 2])
+              {
+                best[side] = found->GetId(i);
+                double end_pt[3];
+                end_points->GetPoint(best[side], end_pt);
+                best_dist[side] = vtk_viewer::pt_dist(pt, end_pt);
+                break;
+              }
+            }
           }
-          break;
         }
-        case 3:
-        {
-          vtkSmartPointer<vtkPoints> tmp = vtkSmartPointer<vtkPoints>::New();
 
-          for(int i = 0 ; i < lines[next_index]->GetNumberOfPoints(); ++i)
-          {
-            double pt[3];
-            lines[next_index]->GetPoint(i, pt);
-            tmp->InsertNextPoint(pt);
-          }
-          for(int i = 0; i < temp_points->GetNumberOfPoints(); ++i)
+        // attach the closest line to that end of the connected line, reversing it if needed
+        int side = best_dist[1] <= best_dist[0] ? 1 : 0;
+        int next_index = best[side] / 2;
+        bool at_front = best[side] % 2 == 0;
+        const std::deque<vtkIdType>& next_line = lines[next_index];
+        if(side == 0 && at_front)
+        {
+          for(int i = 0; i < next_line.size(); ++i)
           {
-            double pt[3];
-            temp_points->GetPoint(i, pt);
-            tmp->InsertNextPoint(pt);
+            connected.push_front(next_line[i]);
           }
-          temp_points->SetNumberOfPoints(tmp->GetNumberOfPoints());
-          temp_points->DeepCopy(tmp);
-          break;
         }
-        case 4:
+        else if(side == 0)
         {
-          for(int i = lines[next_index]->GetNumberOfPoints() - 1 ; i >= 0; --i)
+          for(int i = next_line.size() - 1; i >= 0; --i)
           {
-            temp_points->InsertNextPoint(lines[next_index]->GetPoint(i));
+            connected.push_front(next_line[i]);
           }
-          break;
         }
-        default:
-          break;
+        else if(at_front)
+        {
+          connected.insert(connected.end(), next_line.begin(), next_line.end());
+        }
+        else
+        {
+          connected.insert(connected.end(), next_line.rbegin(), next_line.rend());
         }
-        lines.erase(lines.begin() + next_index);
+        used[next_index] = true;
+      }
+    }
 
-      }// end of while loop
-      points = temp_points;
-    }// end concatenating lines together
+    // copy the points of the connected line, each point takes the cell of the segment to the next point.  The last
+    // point of every stitched line has no segment to the next point (the gap to the next line is not on the mesh) and
+    // gets no cell.
+    vtkSmartPointer<vtkPoints> connected_pts = vtkSmartPointer<vtkPoints>::New();
+    connected_pts->SetDataTypeToDouble();
+    connected_pts->SetNumberOfPoints(connected.size());
+    cell_ids->SetNumberOfValues(connected.size());
+    for(int i = 0; i < connected.size(); ++i)
+    {
+      double pt[3];
+      line->GetPoint(connected[i], pt);
+      connected_pts->SetPoint(i, pt);
 
+      vtkIdType mesh_cell = -1;
+      if(i + 1 < connected.size())
+      {
+        for(vtkIdType k = offsets[connected[i]]; k < offsets[connected[i] + 1]; ++k)
+        {
+          if(neighbors[k] == connected[i + 1])
+          {
+            mesh_cell = neighbor_cells[k];
+            break;
+          }
+        }
+      }
+      cell_ids->SetValue(i, mesh_cell);
+    }
+    points = connected_pts;
   }
 
-  double RasterToolPathPlanner::getConnectedIntersectionLine(vtkSmartPointer<vtkPolyData> line, vtkSmartPointer<vtkPoints>& points, std::vector<int>& used_ids, int start_pt)
+  double RasterToolPathPlanner::getConnectedIntersectionLine(vtkSmartPointer<vtkPolyData> line,
+                                                             const std::vector<vtkIdType>& offsets,
+                                                             const std::vector<vtkIdType>& neighbors,
+                                                             std::vector<bool>& visited, vtkIdType start_pt,
+                                                             std::deque<vtkIdType>& ids)
   {
-    int search_location = 0;
-    int num_points = line->GetNumberOfPoints();
-    int num_lines = line->GetNumberOfLines();
-
-    vtkSmartPointer<vtkCellArray> line_data = vtkSmartPointer<vtkCellArray>::New();
-    line_data = line->GetLines();
-    line_data->InitTraversal();
-
-    std::vector<int> ids;
-
-    // get line segment for given point
+    ids.clear();
     ids.push_back(start_pt);
-    int next_id = start_pt;
+    visited[start_pt] = true;
     double line_length = 0.0;
 
-    while(ids.size() < num_points)
+    // walk forward (appending) and then backward (prepending) from the start point until no unused neighbor is left
+    bool closed = false;
+    for(int side = 0; side < 2 && !closed; ++side)
     {
-      // get the next point id, loop through all line to find
-      int j = 0;
-
-      // if next_id is already used, exit
-      if(std::find(used_ids.begin(), used_ids.end(), next_id) != used_ids.end())
-      {
-        break;
-      }
-
-      line_data->InitTraversal();
-      for(j = 0; j < num_lines; ++j)
+      vtkIdType current = start_pt;
+      while(true)
       {
-        vtkSmartPointer<vtkIdList> temp_cell = vtkSmartPointer<vtkIdList>::New();
-        line_data->GetNextCell(temp_cell);
-        if(temp_cell->GetNumberOfIds() == 0)
-        {
-          continue;
-        }
-        if(next_id == temp_cell->GetId(search_location))
+        vtkIdType next = -1;
+        bool loop = false;
+        for(vtkIdType i = offsets[current]; i < offsets[current + 1]; ++i)
         {
-          // based on search direction, determine which value to insert in the id list (first or second)
-          int location = (search_location + 1) % 2;
-          double pt[3], pt_temp[3];
-          line->GetPoint(next_id, pt);
-
-          next_id = temp_cell->GetId(location);
-          line->GetPoint(next_id, pt_temp);
-
-          // get distance of current line segment and add to total distance
-          line_length += sqrt(vtk_viewer::pt_dist(&pt[0], &pt_temp[0]));
-
-          // insert next id
-          if(search_location)
+          if(!visited[neighbors[i]])
           {
-            ids.insert(ids.begin(), next_id);
+            next = neighbors[i];
+            break;
           }
-          else
+          loop = loop || (side == 0 && neighbors[i] == start_pt && ids.size() > 2);
+        }
+
+        // if we have gone around a complete loop, close it with the first point
+        if(next < 0)
+        {
+          if(!loop)
           {
-            ids.push_back(next_id);
+            break;
           }
-          break;
+          next = start_pt;
+          closed = true;
         }
-      }
-
-      // If we have gone around a complete loop, next_id will equal first id, then break
-      if( (next_id == ids.front() && search_location == 0) || (next_id == ids.back() && search_location == 1))
-      {
-        break;
-      }
 
-      // completed loop without finding a match
-      if(j == num_lines && ids.size() < num_points && search_location == 0)
-      {
-          search_location = 1;
-          next_id = ids[0];
-        // search from the front to connect points
-      }
-      else if(j == num_lines && search_location == 1)
-      {
-        break;
-      }
-    } // end loop getting connected lines
+        double pt[3], pt_next[3];
+        line->GetPoint(current, pt);
+        line->GetPoint(next, pt_next);
+        line_length += sqrt(vtk_viewer::pt_dist(&pt[0], &pt_next[0]));
 
-    // copy the ids used into the in_id list
-    used_ids.insert(used_ids.end(), ids.begin(), ids.end());
+        if(side == 0)
+        {
+          ids.push_back(next);
+        }
+        else
+        {
+          ids.push_front(next);
+        }
 
-    // Copy the line ids into a VTK list
-    vtkSmartPointer<vtkIdList> connected_pts = vtkSmartPointer<vtkIdList>::New();
-    connected_pts->SetNumberOfIds(ids.size());
-    for(int i = 0; i < ids.size(); ++i)
-    {
-      connected_pts->SetId(i, ids[i]);
+        if(closed)
+        {
+          break;
+        }
+        visited[next] = true;
+        current = next;
+      }
     }
 
-    // set point size and copy points to return
-    points->Reset();
-    points->Squeeze();
-    points->SetNumberOfPoints(ids.size());
-    line->GetPoints()->GetPoints(connected_pts, points);
-
     return line_length;
   }
 
@@ -1047,89 +1643,38 @@ namespace tool_path_planner
     points->DeepCopy(new_points);
   }
 
-  void RasterToolPathPlanner::smoothData(vtkSmartPointer<vtkParametricSpline> spline, vtkSmartPointer<vtkPolyData>& points, vtkSmartPointer<vtkPolyData>& derivatives)
+  void RasterToolPathPlanner::smoothData(vtkSmartPointer<vtkPolyData> intersection, CompactPath& path)
   {
-    vtkSmartPointer<vtkPoints> new_points = vtkSmartPointer<vtkPoints>::New();
-
-    vtkSmartPointer<vtkDoubleArray> derv = vtkSmartPointer<vtkDoubleArray>::New();
-    derv->SetNumberOfComponents(3);
-
-    Eigen::Vector3d new_pt(0, 0, 0);
-
-    // get points which are evenly spaced along the spline
-    // initialize num_line_pts to some number, find the Euclidean distance between two points (m & n),
-    // then use this distance to determine how many points should be used in the given line
-    int num_line_pts = 10;
-    double m[3], n[3];
-
-    double u[3], pt[3], d[9]; // u - search point, pt - resulting point, d - unused but still required
-    u[0] = u[1] = u[2] = 0;
-
-    // spline->Evaluate() takes a number in the range [0,1]
-    spline->Evaluate(u, m, d);
-    u[0] = 1/double(num_line_pts);
-    spline->Evaluate(u, n, d);
-
-    // calculate new point spacing
-    double s = sqrt(vtk_viewer::pt_dist(&m[0], &n[0]));
-    num_line_pts = round( double(num_line_pts) / (tool_.pt_spacing / s));
-
-    // Get points evenly spaced along the spline
-    for( int i = 0; i <= num_line_pts; ++i)
+    std::vector<double> tangents, params;
     {
-      // Get point and store
-      u[0] = double(i)/double(num_line_pts);
-      u[1] = double(i)/double(num_line_pts);
-      u[2] = double(i)/double(num_line_pts);
-      spline->Evaluate(u, pt, d);
-      new_points->InsertNextPoint(pt);
+      StageTimer timer(collect_stats_ ? &stats_.smoothing_time : NULL, stats_mutex_);
 
+      // get points which are evenly spaced (by arc length) along a spline through the intersection, the tangents come
+      // from the spline polynomials
+      PathSpline spline;
+      spline.setPoints(intersection->GetPoints());
+      spline.resample(tool_.pt_spacing, path.points, tangents, params);
 
-      double pt1[3], pt2[3];
-      // find nearby points in order to calculate the local deriviative
-      if(i == 0)
+      // the derivatives point back along the line (towards the previous point)
+      path.derivatives.resize(tangents.size());
+      for(int i = 0; i < tangents.size(); ++i)
       {
-        pt1[0] = pt[0];
-        pt1[1] = pt[1];
-        pt1[2] = pt[2];
-        u[0] += 1.0/(1.0*double(num_line_pts));
-        spline->Evaluate(u, pt2, d);
+        path.derivatives[i] = -tangents[i];
       }
-      else if(i == num_line_pts)
-      {
-        pt2[0] = pt[0];
-        pt2[1] = pt[1];
-        pt2[2] = pt[2];
-        u[0] -= 1.0/(1.0*double(num_line_pts));
-        spline->Evaluate(u, pt1, d);
-      }
-      else
-      {
-        double u2[3] = {u[0], u[1], u[2]};
-        u2[0] += 1/(1*double(num_line_pts));
-        spline->Evaluate(u2, pt2, d);
-
-        u[0] -= 1/(1*double(num_line_pts));
-        spline->Evaluate(u, pt1, d);
-      }
-
-      // calculate the derivative and normalize
-      new_pt[0] = pt1[0] - pt2[0];
-      new_pt[1] = pt1[1] - pt2[1];
-      new_pt[2] = pt1[2] - pt2[2];
-      new_pt.normalize();
-
-      // insert the next derivative
-      double new_ptr[3] = {new_pt[0], new_pt[1], new_pt[2]};
-      derv->InsertNextTuple(&new_ptr[0]);
     }
-    // Set points and normals
-    points->SetPoints(new_points);
-    estimateNewNormals(points);
+    addStat(stats_.points, path.size());
+    if(collect_stats_)
+    {
+      // the intersection (points and cell ids), the samples with their tangents and parameters, normals and derivatives
+      long num_hits = intersection->GetNumberOfPoints();
+      updateScratchStat(num_hits * (3 * sizeof(double) + sizeof(vtkIdType)) +
+                        (4 * path.points.size() + params.size()) * sizeof(double));
+    }
 
-    // Set points and derivatives
-    derivatives->SetPoints(new_points);
-    derivatives->GetPointData()->SetNormals(derv);
+    if(normal_estimation_ != BARYCENTRIC || !estimateNormalsBarycentric(path.points, intersection, params, path.normals))
+    {
+      estimateNormals(path.points, path.normals);
+    }
   }
 
   // Sort points in linear order
@@ -1213,25 +1758,46 @@ namespace tool_path_planner
 
   void RasterToolPathPlanner::estimateNewNormals(vtkSmartPointer<vtkPolyData>& data)
   {
-    if(use_ransac_normal_estimation_){
-      estimateNewNormalsRansac(data);
+    std::vector<double> points, normals;
+    getPointArray(data, points);
+    estimateNormals(points, normals);
+    setNormalArray(data, normals);
+  }
+
+  void RasterToolPathPlanner::estimateNewNormalsRansac(vtkSmartPointer<vtkPolyData>& data)
+  {
+    std::vector<double> points, normals;
+    getPointArray(data, points);
+    estimateNormalsRansac(points, normals);
+    setNormalArray(data, normals);
+  }
+
+  void RasterToolPathPlanner::estimateNormals(const std::vector<double>& points, std::vector<double>& normals)
+  {
+    if(normal_estimation_ == RANSAC){
+      estimateNormalsRansac(points, normals);
       return;
     }
+    estimateNormalsNearest(points, normals);
+  }
 
-    // Find k nearest neighbors and use their normals to estimate the normal of the desired point
-    vtkSmartPointer<vtkDoubleArray> new_norm = vtkSmartPointer<vtkDoubleArray>::New();
-    new_norm->SetNumberOfComponents(3);
-    new_norm->SetNumberOfTuples(data->GetPoints()->GetNumberOfPoints());
+  void RasterToolPathPlanner::estimateNormalsNearest(const std::vector<double>& points, std::vector<double>& normals)
+  {
+    StageTimer timer(collect_stats_ ? &stats_.normal_estimation_time : NULL, stats_mutex_);
 
-    for(int i = 0; i < data->GetPoints()->GetNumberOfPoints(); ++i)
+    // Find k nearest neighbors and use their normals to estimate the normal of the desired point
+    int num_pts = points.size() / 3;
+    normals.assign(3 * num_pts, 0.0);
+    if(tool_.nearest_neighbors <= input_mesh_->GetPoints()->GetNumberOfPoints())
     {
-      // Get the next point to estimate the normal
-      double pt[3];
-      data->GetPoints()->GetPoint(i, &pt[0]);
-
+      addStat(stats_.kd_tree_queries, num_pts);
+    }
+    vtkSmartPointer<vtkIdList> result = vtkSmartPointer<vtkIdList>::New();
 
-      double testPoint[3] = {pt[0], pt[1], pt[2]};
-      vtkSmartPointer<vtkIdList> result = vtkSmartPointer<vtkIdList>::New();
+    for(int i = 0; i < num_pts; ++i)
+    {
+      double testPoint[3] = {points[3 * i], points[3 * i + 1], points[3 * i + 2]};
+      result->Reset();
 
       // Find N nearest neighbors to the point, if N is greater than # of points, return all points
       if(tool_.nearest_neighbors > input_mesh_->GetPoints()->GetNumberOfPoints())
@@ -1272,125 +1838,305 @@ namespace tool_path_planner
         final.normalize();
       }
 
-      // Insert the averaged normal
-      new_norm->SetTuple3(i, final[0], final[1], final[2]);
+      normals[3 * i] = final[0];
+      normals[3 * i + 1] = final[1];
+      normals[3 * i + 2] = final[2];
     }
-    // Insert the normal data
-    data->GetPointData()->SetNormals(new_norm);
   }
-  void RasterToolPathPlanner::estimateNewNormalsRansac(vtkSmartPointer<vtkPolyData>& data)
+
+  bool RasterToolPathPlanner::estimateNormalRansac(vtkKdTreePointLocator* kd_tree, vtkPolyData* mesh,
+                                                   const ProcessTool& tool, const double pt[3],
+                                                   RansacScratch& scratch, double normal[3])
   {
-    // Find k nearest neighbors and use their normals to estimate the normal of the desired point
-    vtkSmartPointer<vtkDoubleArray> new_norm = vtkSmartPointer<vtkDoubleArray>::New();
-    new_norm->SetNumberOfComponents(3);
-    new_norm->SetNumberOfTuples(data->GetPoints()->GetNumberOfPoints());
+    normal[0] = normal[1] = normal[2] = 0.0;
 
-    for(int i = 0; i < data->GetPoints()->GetNumberOfPoints(); ++i)
+    // Find N nearest neighbors to the point, if N is greater than # of points, return all points
+    vtkIdList* result = scratch.result;
+    result->Reset();
+    if(tool.nearest_neighbors > mesh->GetPoints()->GetNumberOfPoints())
+    {
+      for(int j = 0; j < mesh->GetPoints()->GetNumberOfPoints(); ++j)
+      {
+        result->InsertNextId(j);
+      }
+    }
+    else
+    {
+      double test_point[3] = {pt[0], pt[1], pt[2]};
+      kd_tree->FindClosestNPoints(tool.nearest_neighbors, test_point, result);
+    }
+    if(result->GetNumberOfIds() == 0)
     {
-      // Get the next point to estimate the normal
-      double pt[3],pn[3];
-      data->GetPoints()->GetPoint(i, &pt[0]);
+      return true;
+    }
 
-      double testPoint[3] = {pt[0], pt[1], pt[2]};
-      vtkSmartPointer<vtkIdList> result = vtkSmartPointer<vtkIdList>::New();
+    double pn[3];
+    mesh->GetPointData()->GetNormals()->GetTuple(result->GetId(0), pn);
 
-      // Find N nearest neighbors to the point, if N is greater than # of points, return all points
-      if(tool_.nearest_neighbors > input_mesh_->GetPoints()->GetNumberOfPoints())
+    scratch.cloud->clear();
+    for(int j = 0; j < result->GetNumberOfIds(); ++j)
+    {
+      double pt2[3];
+      mesh->GetPoints()->GetPoint(result->GetId(j), pt2);
+      if(std::isnan(pt2[0]) || std::isnan(pt2[1]) || std::isnan(pt2[2]))
       {
-        for(int j = 0; j < input_mesh_->GetPoints()->GetNumberOfPoints(); ++j)
-        {
-          result->InsertNextId(j);
-        }
+        continue;
       }
-      else
+      scratch.cloud->push_back(pcl::PointXYZ(pt2[0], pt2[1], pt2[2]));
+    }
+
+    // a new model and ransac per point, both start from the fixed default seed (not random), so the result of a point
+    // does not depend on which thread computes it or on the points computed before it
+    pcl::SampleConsensusModelPlane<pcl::PointXYZ>::Ptr
+        model_p(new pcl::SampleConsensusModelPlane<pcl::PointXYZ>(scratch.cloud, false));
+    pcl::RandomSampleConsensus<pcl::PointXYZ> ransac(model_p, tool.plane_fit_threhold);
+
+    if(!ransac.computeModel())
+    {
+      return false;
+    }
+
+    Eigen::VectorXf icoeff;
+    Eigen::VectorXf coeff;
+    ransac.getInliers(scratch.inliers);
+    ransac.getModelCoefficients(icoeff);
+    if(scratch.inliers.size() > 3)
+    {
+      model_p->optimizeModelCoefficients(scratch.inliers, icoeff, coeff);
+    }
+    else
+    {
+      coeff = icoeff;
+    }
+
+    // switch sign of normal if its not aligned with original point's normal
+    Eigen::Vector3d final(coeff[0], coeff[1], coeff[2]);
+    if(final[0] * pn[0] + final[1] * pn[1] + final[2] * pn[2] < 0)
+    {
+      final = -final;
+    }
+    final.normalize();
+    normal[0] = final[0];
+    normal[1] = final[1];
+    normal[2] = final[2];
+    return true;
+  }
+
+  void RasterToolPathPlanner::estimateNormalsRansac(const std::vector<double>& points, std::vector<double>& normals)
+  {
+    StageTimer timer(collect_stats_ ? &stats_.normal_estimation_time : NULL, stats_mutex_);
+
+    int num_pts = points.size() / 3;
+    normals.assign(3 * num_pts, 0.0);
+    if(tool_.nearest_neighbors <= input_mesh_->GetPoints()->GetNumberOfPoints())
+    {
+      addStat(stats_.kd_tree_queries, num_pts);
+    }
+
+    // the concurrent sweeps take turns, each uses all the ransac threads
+    std::lock_guard<std::mutex> lock(ransac_mutex_);
+    if(!ransac_pool_)
+    {
+      ransac_pool_.reset(new vtk_viewer::ThreadPool(num_threads_));
+      ransac_scratch_.resize(ransac_pool_->getNumThreads());
+      for(int i = 0; i < ransac_scratch_.size(); ++i)
       {
-        kd_tree_->FindClosestNPoints(tool_.nearest_neighbors, testPoint, result);
+        ransac_scratch_[i].result = vtkSmartPointer<vtkIdList>::New();
+        ransac_scratch_[i].cloud.reset(new pcl::PointCloud<pcl::PointXYZ>());
       }
-      input_mesh_->GetPointData()->GetNormals()->GetTuple(result->GetId(0), &pn[0]);
-
-      Eigen::Vector3d final(0, 0, 0);
+    }
+    std::vector<RansacScratch>& scratch = ransac_scratch_;
+    for(int i = 0; i < scratch.size(); ++i)
+    {
+      scratch[i].failures = 0;
+    }
+    updateScratchStat(long(scratch.size()) * tool_.nearest_neighbors *
+                      (sizeof(vtkIdType) + sizeof(pcl::PointXYZ) + sizeof(int)));
 
-      pcl::PointCloud<pcl::PointXYZ>::Ptr local_cloud(new pcl::PointCloud<pcl::PointXYZ>());
-      int cloud_count = 0;
-      for(int j = 0; j < result->GetNumberOfIds(); ++j)
+    // points are handed out in batches, every thread reuses its own scratch buffers for all of its points
+    int num_batches = (num_pts + RANSAC_BATCH_SIZE - 1) / RANSAC_BATCH_SIZE;
+    ransac_pool_->parallelFor(num_batches, [&](int batch, int thread_id)
+    {
+      int end = std::min(num_pts, (batch + 1) * RANSAC_BATCH_SIZE);
+      for(int i = batch * RANSAC_BATCH_SIZE; i < end; ++i)
       {
-        double pt2[3];
-        input_mesh_->GetPoints()->GetPoint(result->GetId(j),&pt2[0]);
-        if(std::isnan(pt2[0]) || std::isnan(pt2[1]) || std::isnan(pt2[2]))
+        if(!estimateNormalRansac(kd_tree_, input_mesh_, tool_, &points[3 * i], scratch[thread_id], &normals[3 * i]))
         {
-          continue;
+          ++scratch[thread_id].failures;
         }
-        local_cloud->push_back(pcl::PointXYZ(pt2[0],pt2[1],pt2[2]));
-        cloud_count++;
       }
-      std::vector<int> inliers;
-      inliers.clear();
-      pcl::SampleConsensusModelPlane<pcl::PointXYZ>::Ptr
-          model_p(new pcl::SampleConsensusModelPlane<pcl::PointXYZ> (local_cloud));
-      pcl::RandomSampleConsensus<pcl::PointXYZ> ransac(model_p,tool_.plane_fit_threhold);
-
-      bool isgood = ransac.computeModel();
-      Eigen::VectorXf icoeff;
-      Eigen::VectorXf coeff;
-      if(isgood){
-        std::vector<int> inliers;
-        ransac.getInliers(inliers);
-        ransac.getModelCoefficients (icoeff);
-        if(inliers.size()>3){
-          model_p->optimizeModelCoefficients(inliers,icoeff,coeff);
+    });
+
+    // report the failures once, from the calling thread, instead of once per point from the worker threads
+    long failures = 0;
+    for(int i = 0; i < scratch.size(); ++i)
+    {
+      failures += scratch[i].failures;
+    }
+    if(failures > 0)
+    {
+      addStat(stats_.ransac_failures, failures);
+      cout << "ransac failed to find a plane for " << failures << " of " << num_pts << " points\n";
+    }
+  }
+
+  bool RasterToolPathPlanner::estimateNormalsBarycentric(const std::vector<double>& points,
+                                                         vtkSmartPointer<vtkPolyData> intersection,
+                                                         const std::vector<double>& params, std::vector<double>& normals)
+  {
+    vtkIdTypeArray* cells = intersection ?
+          vtkIdTypeArray::SafeDownCast(intersection->GetPointData()->GetArray(MESH_CELL_IDS)) : NULL;
+    vtkIdType num_hits = intersection ? intersection->GetPoints()->GetNumberOfPoints() : 0;
+    int num_pts = points.size() / 3;
+    if(!cells || num_hits < 2 || params.size() != num_pts || !input_mesh_->GetPointData()->GetNormals())
+    {
+      return false;
+    }
+
+    // the spline is parameterized by the chord length along the intersection points, so the parameter of a sample
+    // tells which intersection segment (and so which mesh cell) it lies on
+    std::vector<double> lengths(num_hits, 0.0);
+    for(vtkIdType i = 1; i < num_hits; ++i)
+    {
+      double pt1[3], pt2[3];
+      intersection->GetPoints()->GetPoint(i - 1, pt1);
+      intersection->GetPoints()->GetPoint(i, pt2);
+      lengths[i] = lengths[i - 1] + sqrt(vtkMath::Distance2BetweenPoints(pt1, pt2));
+    }
+
+    normals.assign(3 * num_pts, 0.0);
+    std::vector<int> missing;
+    std::vector<double> missing_pts;
+    {
+      StageTimer timer(collect_stats_ ? &stats_.normal_estimation_time : NULL, stats_mutex_);
+      vtkIdType segment = 0;
+      for(int i = 0; i < num_pts; ++i)
+      {
+        while(segment + 2 < num_hits && lengths[segment + 1] < params[i])
+        {
+          ++segment;
         }
-        else{
-          coeff[0] = icoeff[0];
-          coeff[1] = icoeff[1];
-          coeff[2] = icoeff[2];
+
+        if(!interpolateNormal(&points[3 * i], cells->GetValue(segment), &normals[3 * i]))
+        {
+          missing.push_back(i);
+          missing_pts.insert(missing_pts.end(), &points[3 * i], &points[3 * i] + 3);
         }
-        // switch sign of normal if its not aligned with original point's normal
-        double dot = coeff[0]*pn[0] + coeff[1]*pn[1] + coeff[2]*pn[2];
-        int normal_sign = 1;
-        if(dot<0) normal_sign = -1;
-        final[0] = normal_sign*coeff[0];
-        final[1] = normal_sign*coeff[1];
-        final[2] = normal_sign*coeff[2];
-      }
-      else{
-        cout << "ransac failed to find a plane\n";
       }
-      final.normalize(); // not sure we need this
+    }
 
-      // Insert the ransac normal
-      new_norm->SetTuple3(i, final[0], final[1], final[2]);
+    // points between fragments of the intersection have no cell, use their nearest neighbors
+    if(!missing.empty())
+    {
+      std::vector<double> missing_normals;
+      estimateNormals(missing_pts, missing_normals);
+      for(int i = 0; i < missing.size(); ++i)
+      {
+        std::copy(&missing_normals[3 * i], &missing_normals[3 * i] + 3, &normals[3 * missing[i]]);
+      }
     }
-    // Insert the normal data
-    data->GetPointData()->SetNormals(new_norm);
+
+    return true;
   }
 
-  vtkSmartPointer<vtkPolyData> RasterToolPathPlanner::createOffsetLine(vtkSmartPointer<vtkPolyData> line, vtkSmartPointer<vtkPolyData> derivatives, double dist)
+  bool RasterToolPathPlanner::interpolateNormal(const double pt[3], vtkIdType cell, double normal[3])
   {
-    vtkSmartPointer<vtkPolyData> new_points;
+    if(cell < 0 || cell >= input_mesh_->GetNumberOfCells())
+    {
+      return false;
+    }
 
-    vtkDataArray* normals = line->GetPointData()->GetNormals();
-    vtkDataArray* ders = derivatives->GetPointData()->GetNormals();
+    vtkIdType npts;
+    vtkIdType* ids;
+    input_mesh_->GetCellPoints(cell, npts, ids);
+    if(npts < 3)
+    {
+      return false;
+    }
 
-    // If normal or derivative data does not exist, or number of normals and derivatives do not match, return a null pointer
-    if(!normals || !ders || normals->GetNumberOfTuples() != ders->GetNumberOfTuples())
+    // find the triangle of the fan the point projects into (or is closest to) and its barycentric coordinates
+    Eigen::Vector3d p(pt[0], pt[1], pt[2]);
+    double best_score = -std::numeric_limits<double>::max();
+    double weights[3] = {1.0, 0.0, 0.0};
+    vtkIdType corners[3] = {ids[0], ids[1], ids[2]};
+    for(vtkIdType j = 1; j + 1 < npts; ++j)
     {
-      return new_points;
+      double a[3], b[3], c[3];
+      input_mesh_->GetPoints()->GetPoint(ids[0], a);
+      input_mesh_->GetPoints()->GetPoint(ids[j], b);
+      input_mesh_->GetPoints()->GetPoint(ids[j + 1], c);
+      Eigen::Vector3d v0(b[0] - a[0], b[1] - a[1], b[2] - a[2]);
+      Eigen::Vector3d v1(c[0] - a[0], c[1] - a[1], c[2] - a[2]);
+      Eigen::Vector3d v2 = p - Eigen::Vector3d(a[0], a[1], a[2]);
+
+      double d00 = v0.dot(v0), d01 = v0.dot(v1), d11 = v1.dot(v1);
+      double d20 = v2.dot(v0), d21 = v2.dot(v1);
+      double denom = d00 * d11 - d01 * d01;
+      if(denom <= 0.0)
+      {
+        continue;
+      }
+      double v = (d11 * d20 - d01 * d21) / denom;
+      double w = (d00 * d21 - d01 * d20) / denom;
+      double u = 1.0 - v - w;
+
+      double score = std::min(u, std::min(v, w));
+      if(score > best_score)
+      {
+        best_score = score;
+        weights[0] = u; weights[1] = v; weights[2] = w;
+        corners[0] = ids[0]; corners[1] = ids[j]; corners[2] = ids[j + 1];
+      }
+    }
+
+    // points slightly outside the cell (the spline is not exactly on the mesh) are clamped to it
+    Eigen::Vector3d final(0, 0, 0);
+    for(int j = 0; j < 3; ++j)
+    {
+      double n[3];
+      input_mesh_->GetPointData()->GetNormals()->GetTuple(corners[j], n);
+      if(std::isnan(n[0]) || std::isnan(n[1]) || std::isnan(n[2]) || vtkMath::Normalize(n) <= 0.0)
+      {
+        continue;
+      }
+      double weight = std::max(0.0, weights[j]);
+      final[0] += weight * n[0];
+      final[1] += weight * n[1];
+      final[2] += weight * n[2];
+    }
+
+    if(final.norm() <= 0.0)
+    {
+      return false;
     }
+    final.normalize();
+    normal[0] = final[0];
+    normal[1] = final[1];
+    normal[2] = final[2];
+    return true;
+  }
+
+  vtkSmartPointer<vtkPolyData> RasterToolPathPlanner::createOffsetLine(const CompactPath& path, double dist)
+  {
+    vtkSmartPointer<vtkPolyData> new_points;
 
-    if(normals->GetNumberOfTuples() != line->GetNumberOfPoints())
+    // If normal or derivative data does not exist, or number of normals and derivatives do not match, return a null pointer
+    if(path.normals.size() != path.points.size() || path.derivatives.size() != path.points.size() || path.size() < 2)
     {
-      cout << "ERROR IN CALC OFFSET LINE\n";
+      return new_points;
     }
 
     new_points = vtkSmartPointer<vtkPolyData>::New();
     vtkSmartPointer<vtkPoints> new_pts = vtkSmartPointer<vtkPoints>::New();
+    new_pts->SetNumberOfPoints(path.size());
 
     // calculate offset for each point
-    for(int i = 0; i < normals->GetNumberOfTuples(); ++i)
+    for(int i = 0; i < path.size(); ++i)
     {
       //calculate cross to get offset direction
-      double* pt1 = normals->GetTuple(i);
-      double* pt2 = ders->GetTuple(i);
+      const double* pt = &path.points[3 * i];
+      const double* pt1 = &path.normals[3 * i];
+      const double* pt2 = &path.derivatives[3 * i];
 
       Eigen::Vector3d u(pt1[0], pt1[1], pt1[2]);
       Eigen::Vector3d v(pt2[0], pt2[1], pt2[2]);
@@ -1399,35 +2145,28 @@ namespace tool_path_planner
 
       // use point, direction w, and dist, to create new point
       double new_pt[3];
-      double* pt = line->GetPoints()->GetPoint(i);
       new_pt[0] = pt[0] + w[0] * dist;
       new_pt[1] = pt[1] + w[1] * dist;
       new_pt[2] = pt[2] + w[2] * dist;
 
-      new_pts->InsertNextPoint(new_pt);
+      new_pts->SetPoint(i, new_pt);
     }
 
     // extrapolate end points to extend line beyond edges
     double new_pt[3];
-    double* pt1;
+    double pt1[3];
 
     // Extend end point
-    pt1 = new_pts->GetPoint(new_pts->GetNumberOfPoints()- 1);
-    new_pt[0] = pt1[0];
-    new_pt[1] = pt1[1];
-    new_pt[2] = pt1[2];
-    pt1 = new_pts->GetPoint(new_pts->GetNumberOfPoints()- 2);
+    new_pts->GetPoint(new_pts->GetNumberOfPoints()- 1, new_pt);
+    new_pts->GetPoint(new_pts->GetNumberOfPoints()- 2, pt1);
     new_pt[0] +=  (new_pt[0] - pt1[0]);
     new_pt[1] +=  (new_pt[1] - pt1[1]);
     new_pt[2] +=  (new_pt[2] - pt1[2]);
     new_pts->SetPoint(new_pts->GetNumberOfPoints()-1, new_pt);
 
     // Extend front point
-    pt1 = new_pts->GetPoint(0);
-    new_pt[0] = pt1[0];
-    new_pt[1] = pt1[1];
-    new_pt[2] = pt1[2];
-    pt1 = new_pts->GetPoint(1);
+    new_pts->GetPoint(0, new_pt);
+    new_pts->GetPoint(1, pt1);
     new_pt[0] +=  (new_pt[0] - pt1[0]);
     new_pt[1] +=  (new_pt[1] - pt1[1]);
     new_pt[2] +=  (new_pt[2] - pt1[2]);
@@ -1442,10 +2181,28 @@ namespace tool_path_planner
 
   vtkSmartPointer<vtkPolyData> RasterToolPathPlanner::createSurfaceFromSpline(vtkSmartPointer<vtkPolyData> line, double dist)
   {
-    vtkSmartPointer<vtkPolyData> new_surface;
     vtkSmartPointer<vtkDataArray> normals = line->GetPointData()->GetNormals();
-
     if(!normals)
+    {
+      cout << "no normals, cannot create surface\n";
+      return vtkSmartPointer<vtkPolyData>();
+    }
+
+    std::vector<double> points, norms(3 * normals->GetNumberOfTuples());
+    getPointArray(line, points);
+    for(int i = 0; i < normals->GetNumberOfTuples(); ++i)
+    {
+      normals->GetTuple(i, &norms[3 * i]);
+    }
+    return createSurfaceFromSpline(points, norms, dist);
+  }
+
+  vtkSmartPointer<vtkPolyData> RasterToolPathPlanner::createSurfaceFromSpline(const std::vector<double>& points,
+                                                                              const std::vector<double>& normals,
+                                                                              double dist)
+  {
+    vtkSmartPointer<vtkPolyData> new_surface;
+    if(normals.empty() || normals.size() > points.size())
     {
       cout << "no normals, cannot create surface\n";
       return new_surface;
@@ -1453,16 +2210,18 @@ namespace tool_path_planner
 
     new_surface = vtkSmartPointer<vtkPolyData>::New();
     vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
-    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    vtkSmartPointer<vtkPoints> surface_points = vtkSmartPointer<vtkPoints>::New();
+    int num_pts = normals.size() / 3;
+    surface_points->SetNumberOfPoints(2 * num_pts);
 
     // for each point, insert 2 points, one above and one below, to create a new surface
-    for(int i = 0; i < normals->GetNumberOfTuples(); ++i)
+    for(int i = 0; i < num_pts; ++i)
     {
-      double* norm = normals->GetTuple(i);
-      double* pt = line->GetPoints()->GetPoint(i);
+      const double* norm = &normals[3 * i];
+      const double* pt = &points[3 * i];
 
       // insert the cell ids to create triangles
-      if(i < normals->GetNumberOfTuples()-1)
+      if(i < num_pts - 1)
       {
         vtkIdType start = i*2;
 
@@ -1482,21 +2241,45 @@ namespace tool_path_planner
       new_pt[1] = pt[1] + norm[1] * dist;
       new_pt[2] = pt[2] + norm[2] * dist;
 
-      points->InsertNextPoint( new_pt);
+      surface_points->SetPoint(2 * i, new_pt);
 
       double new_pt2[3];
       new_pt2[0] = pt[0] - norm[0] * dist;
       new_pt2[1] = pt[1] - norm[1] * dist;
       new_pt2[2] = pt[2] - norm[2] * dist;
 
-      points->InsertNextPoint( new_pt2);
+      surface_points->SetPoint(2 * i + 1, new_pt2);
     }
 
     new_surface->SetPolys(cells);
-    new_surface->SetPoints(points);
+    new_surface->SetPoints(surface_points);
     return new_surface;
   }
 
+  bool RasterToolPathPlanner::surfacesIntersect(vtkSmartPointer<vtkPolyData> surface1, vtkSmartPointer<vtkPolyData> surface2)
+  {
+    StageTimer timer(collect_stats_ ? &stats_.self_intersection_time : NULL, stats_mutex_);
+    addStat(stats_.self_intersection_checks, 1);
+
+    // most checks are against surfaces far away, skip building the hierarchy when the bounding boxes are apart
+    double bounds1[6], bounds2[6];
+    if(!getPointBounds(surface1, bounds1) || !getPointBounds(surface2, bounds2))
+    {
+      return false;
+    }
+    for(int i = 0; i < 3; ++i)
+    {
+      if(bounds1[2 * i] > bounds2[2 * i + 1] || bounds2[2 * i] > bounds1[2 * i + 1])
+      {
+        return false;
+      }
+    }
+
+    MeshIntersector intersector;
+    intersector.setInputMesh(surface2);
+    return intersector.intersects(surface1);
+  }
+
   void RasterToolPathPlanner::setCutDirection(double direction [3])
   {
     cut_direction_[0] = direction[0];
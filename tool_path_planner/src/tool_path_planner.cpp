@@ -4,6 +4,7 @@
  *
  */
 
+#include <algorithm>
 #include <limits>
 #include <cmath>
 
@@ -97,6 +98,78 @@ namespace tool_path_planner
     path.spline->SetPoints(points);
   }
 
+  void flipPointOrder(CompactPath& path)
+  {
+    int size = path.size();
+    for(int i = 0; i < size / 2; ++i)
+    {
+      std::swap_ranges(&path.points[3 * i], &path.points[3 * i + 3], &path.points[3 * (size - 1 - i)]);
+      std::swap_ranges(&path.normals[3 * i], &path.normals[3 * i + 3], &path.normals[3 * (size - 1 - i)]);
+      std::swap_ranges(&path.derivatives[3 * i], &path.derivatives[3 * i + 3], &path.derivatives[3 * (size - 1 - i)]);
+    }
+
+    // flip derivative directions
+    for(int i = 0; i < path.derivatives.size(); ++i)
+    {
+      path.derivatives[i] = -path.derivatives[i];
+    }
+  }
+
+  void createProcessPath(const CompactPath& compact, ProcessPath& path)
+  {
+    int size = compact.size();
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->SetDataTypeToDouble();
+    points->SetNumberOfPoints(size);
+    vtkSmartPointer<vtkDoubleArray> normals = vtkSmartPointer<vtkDoubleArray>::New();
+    normals->SetNumberOfComponents(3);
+    normals->SetNumberOfTuples(size);
+    vtkSmartPointer<vtkDoubleArray> derivatives = vtkSmartPointer<vtkDoubleArray>::New();
+    derivatives->SetNumberOfComponents(3);
+    derivatives->SetNumberOfTuples(size);
+    for(int i = 0; i < size; ++i)
+    {
+      points->SetPoint(i, &compact.points[3 * i]);
+      normals->SetTuple(i, &compact.normals[3 * i]);
+      derivatives->SetTuple(i, &compact.derivatives[3 * i]);
+    }
+
+    path.line = vtkSmartPointer<vtkPolyData>::New();
+    path.line->SetPoints(points);
+    path.line->GetPointData()->SetNormals(normals);
+
+    path.derivatives = vtkSmartPointer<vtkPolyData>::New();
+    path.derivatives->SetPoints(points);
+    path.derivatives->GetPointData()->SetNormals(derivatives);
+
+    path.spline = vtkSmartPointer<vtkParametricSpline>::New();
+    path.spline->SetPoints(points);
+  }
+
+  void createCompactPath(const ProcessPath& path, CompactPath& compact)
+  {
+    vtkPoints* points = path.line ? path.line->GetPoints() : NULL;
+    vtkDataArray* normals = path.line ? path.line->GetPointData()->GetNormals() : NULL;
+    vtkDataArray* derivatives = path.derivatives ? path.derivatives->GetPointData()->GetNormals() : NULL;
+    int size = points ? points->GetNumberOfPoints() : 0;
+
+    compact.points.resize(3 * size);
+    compact.normals.assign(3 * size, 0.0);
+    compact.derivatives.assign(3 * size, 0.0);
+    for(int i = 0; i < size; ++i)
+    {
+      points->GetPoint(i, &compact.points[3 * i]);
+      if(normals && i < normals->GetNumberOfTuples())
+      {
+        normals->GetTuple(i, &compact.normals[3 * i]);
+      }
+      if(derivatives && i < derivatives->GetNumberOfTuples())
+      {
+        derivatives->GetTuple(i, &compact.derivatives[3 * i]);
+      }
+    }
+  }
+
   int findClosestPoint(std::vector<double>& pt,  std::vector<std::vector<double> >& pts)
   {
     double min = std::numeric_limits<double>::max();
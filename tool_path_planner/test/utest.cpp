@@ -5,11 +5,22 @@
  *
  */
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <set>
+
 #include <tool_path_planner/raster_tool_path_planner.h>
+#include <tool_path_planner/path_spline.h>
 #include <vtk_viewer/vtk_utils.h>
 #include <vtk_viewer/vtk_viewer.h>
+#include <vtk_viewer/mesh_generator.h>
 #include <gtest/gtest.h>
 #include <vtkIdTypeArray.h>
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkPointData.h>
+#include <vtkMath.h>
 
 #define DISPLAY_LINES  1
 #define DISPLAY_NORMALS  0
@@ -222,6 +233,914 @@ TEST(IntersectTest, TestCaseRansac)
   viz.renderDisplay();
 }
 
+// This test plans the same set of meshes serially and with multiple threads, the resulting paths
+// must be identical and returned in the same (input) order
+
+TEST(IntersectTest, TestCaseParallel)
+{
+  // Get mesh
+  vtkSmartPointer<vtkPoints> points = vtk_viewer::createPlane();
+  vtkSmartPointer<vtkPolyData> data = vtk_viewer::createMesh(points, 0.5, 5);
+  vtk_viewer::generateNormals(data);
+
+  // create cutout in the middle of the mesh
+  vtkSmartPointer<vtkPoints> points2 = vtkSmartPointer<vtkPoints>::New();
+  double pt1[3] = {2.0, 3.0, 0.0};
+  double pt2[3] = {4.0, 2.0, 0.0};
+  double pt3[3] = {5.0, 3.0, 0.0};
+  double pt4[3] = {4.0, 5.0, 0.0};
+  points2->InsertNextPoint(pt1);
+  points2->InsertNextPoint(pt2);
+  points2->InsertNextPoint(pt3);
+  points2->InsertNextPoint(pt4);
+
+  vtkSmartPointer<vtkPolyData> data2 = vtk_viewer::cutMesh(data, points2, false);
+
+  // alternate between the full and the cut mesh so that the segments produce different paths
+  std::vector<vtkSmartPointer<vtkPolyData> > meshes;
+  for(int i = 0; i < 6; ++i)
+  {
+    meshes.push_back(i % 2 == 0 ? data : data2);
+  }
+
+  // Set input tool data
+  tool_path_planner::ProcessTool tool;
+  tool.pt_spacing = 0.5;
+  tool.line_spacing = 0.75;
+  tool.tool_offset = 0.0; // currently unused
+  tool.intersecting_plane_height = 0.2;
+  tool.nearest_neighbors = 30;
+  tool.min_hole_size = 0.1;
+  tool.use_ransac_normal_estimation = false;
+  tool.plane_fit_threhold = .01;
+  tool.min_segment_size = 0.01;
+
+  tool_path_planner::RasterToolPathPlanner serial_planner;
+  serial_planner.setTool(tool);
+  std::vector<std::vector<tool_path_planner::ProcessPath> > serial_paths;
+  serial_planner.planPaths(meshes, serial_paths);
+
+  tool_path_planner::RasterToolPathPlanner parallel_planner;
+  parallel_planner.setTool(tool);
+  parallel_planner.setNumThreads(4);
+  std::vector<std::vector<tool_path_planner::ProcessPath> > parallel_paths;
+  parallel_planner.planPaths(meshes, parallel_paths);
+
+  ASSERT_EQ(serial_paths.size(), parallel_paths.size());
+  for(int i = 0; i < serial_paths.size(); ++i)
+  {
+    ASSERT_EQ(serial_paths[i].size(), parallel_paths[i].size());
+    for(int j = 0; j < serial_paths[i].size(); ++j)
+    {
+      vtkPoints* serial_pts = serial_paths[i][j].line->GetPoints();
+      vtkPoints* parallel_pts = parallel_paths[i][j].line->GetPoints();
+      ASSERT_EQ(serial_pts->GetNumberOfPoints(), parallel_pts->GetNumberOfPoints());
+      for(int k = 0; k < serial_pts->GetNumberOfPoints(); ++k)
+      {
+        double a[3], b[3];
+        serial_pts->GetPoint(k, a);
+        parallel_pts->GetPoint(k, b);
+        EXPECT_DOUBLE_EQ(a[0], b[0]);
+        EXPECT_DOUBLE_EQ(a[1], b[1]);
+        EXPECT_DOUBLE_EQ(a[2], b[2]);
+      }
+    }
+  }
+}
+
+// This test grows the rasters of a single mesh with both sweep directions running at the same time,
+// on an open surface the fronts never meet so the result must match the sequential sweeps
+
+TEST(IntersectTest, TestCaseConcurrentSweeps)
+{
+  // Get mesh
+  vtkSmartPointer<vtkPoints> points = vtk_viewer::createPlane();
+  vtkSmartPointer<vtkPolyData> data = vtk_viewer::createMesh(points, 0.5, 5);
+  vtk_viewer::generateNormals(data);
+
+  // Set input tool data
+  tool_path_planner::ProcessTool tool;
+  tool.pt_spacing = 0.5;
+  tool.line_spacing = 0.75;
+  tool.tool_offset = 0.0; // currently unused
+  tool.intersecting_plane_height = 0.2;
+  tool.nearest_neighbors = 30;
+  tool.min_hole_size = 0.1;
+  tool.use_ransac_normal_estimation = false;
+  tool.plane_fit_threhold = .01;
+  tool.min_segment_size = 0.01;
+
+  tool_path_planner::RasterToolPathPlanner sequential_planner;
+  sequential_planner.setTool(tool);
+  std::vector<tool_path_planner::ProcessPath> sequential_paths;
+  sequential_planner.planPaths(data, sequential_paths);
+
+  tool_path_planner::RasterToolPathPlanner concurrent_planner;
+  concurrent_planner.setTool(tool);
+  concurrent_planner.setConcurrentSweeps(true);
+  std::vector<tool_path_planner::ProcessPath> concurrent_paths;
+  concurrent_planner.planPaths(data, concurrent_paths);
+
+  ASSERT_EQ(sequential_paths.size(), concurrent_paths.size());
+  for(int i = 0; i < sequential_paths.size(); ++i)
+  {
+    vtkPoints* sequential_pts = sequential_paths[i].line->GetPoints();
+    vtkPoints* concurrent_pts = concurrent_paths[i].line->GetPoints();
+    ASSERT_EQ(sequential_pts->GetNumberOfPoints(), concurrent_pts->GetNumberOfPoints());
+    for(int j = 0; j < sequential_pts->GetNumberOfPoints(); ++j)
+    {
+      double a[3], b[3];
+      sequential_pts->GetPoint(j, a);
+      concurrent_pts->GetPoint(j, b);
+      EXPECT_NEAR(a[0], b[0], 1e-9);
+      EXPECT_NEAR(a[1], b[1], 1e-9);
+      EXPECT_NEAR(a[2], b[2], 1e-9);
+    }
+  }
+}
+
+// This test plans a tube with a slit along its bottom, narrower than the line spacing, with concurrent sweeps and no
+// raster limit.  The sweeps go around the tube from the top and run into each other across the slit.  Every run must
+// give the same paths and no two paths may cross
+
+TEST(IntersectTest, TestCaseConcurrentSweepsClosed)
+{
+  // tube of radius 1 along x, 6 long, without the cells on the bottom line (theta = 270 degrees)
+  const int sides = 60;
+  const int rings = 31;
+  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+  vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
+  for(int i = 0; i < rings; ++i)
+  {
+    for(int j = 0; j < sides; ++j)
+    {
+      double theta = 2.0 * vtkMath::Pi() * (j + 0.5) / sides;
+      points->InsertNextPoint(0.2 * i, std::cos(theta), std::sin(theta));
+      if(i > 0 && j != 44)
+      {
+        vtkIdType p0 = (i - 1) * sides + j;
+        vtkIdType p1 = (i - 1) * sides + (j + 1) % sides;
+        vtkIdType tri1[3] = {p0, p1, p1 + sides};
+        vtkIdType tri2[3] = {p0, p1 + sides, p0 + sides};
+        cells->InsertNextCell(3, tri1);
+        cells->InsertNextCell(3, tri2);
+      }
+    }
+  }
+  vtkSmartPointer<vtkPolyData> data = vtkSmartPointer<vtkPolyData>::New();
+  data->SetPoints(points);
+  data->SetPolys(cells);
+  vtk_viewer::generateNormals(data);
+
+  // Set input tool data
+  tool_path_planner::ProcessTool tool;
+  tool.pt_spacing = 0.2;
+  tool.line_spacing = 0.5;
+  tool.tool_offset = 0.0; // currently unused
+  tool.intersecting_plane_height = 0.2;
+  tool.nearest_neighbors = 5;
+  tool.min_hole_size = 0.1;
+  tool.use_ransac_normal_estimation = false;
+  tool.plane_fit_threhold = .01;
+  tool.min_segment_size = 0.01;
+
+  std::vector<tool_path_planner::ProcessPath> runs[3];
+  for(int r = 0; r < 3; ++r)
+  {
+    tool_path_planner::RasterToolPathPlanner planner;
+    planner.setTool(tool);
+    planner.setMaxRasters(0);
+    planner.setConcurrentSweeps(true);
+    double direction[3] = {1.0, 0.0, 0.0};
+    double centroid[3] = {3.0, 0.0, 0.0};
+    planner.setCutDirection(direction);
+    planner.setCutCentroid(centroid);
+    planner.planPaths(data, runs[r]);
+  }
+
+  // the paths run along the tube and cover most of its circumference (about 12 line spacings)
+  const std::vector<tool_path_planner::ProcessPath>& paths = runs[0];
+  EXPECT_GE(paths.size(), 8);
+
+  for(int r = 1; r < 3; ++r)
+  {
+    ASSERT_EQ(paths.size(), runs[r].size());
+    for(int i = 0; i < paths.size(); ++i)
+    {
+      vtkPoints* expected_pts = paths[i].line->GetPoints();
+      vtkPoints* pts = runs[r][i].line->GetPoints();
+      ASSERT_EQ(expected_pts->GetNumberOfPoints(), pts->GetNumberOfPoints());
+      for(int j = 0; j < pts->GetNumberOfPoints(); ++j)
+      {
+        double a[3], b[3];
+        expected_pts->GetPoint(j, a);
+        pts->GetPoint(j, b);
+        EXPECT_EQ(a[0], b[0]);
+        EXPECT_EQ(a[1], b[1]);
+        EXPECT_EQ(a[2], b[2]);
+      }
+    }
+  }
+
+  for(int i = 0; i < paths.size(); ++i)
+  {
+    tool_path_planner::MeshIntersector intersector;
+    intersector.setInputMesh(paths[i].intersection_plane);
+    for(int j = i + 1; j < paths.size(); ++j)
+    {
+      EXPECT_FALSE(intersector.intersects(paths[j].intersection_plane)) << "paths " << i << " and " << j;
+    }
+  }
+}
+
+// This test intersects a vertical ribbon with the mesh, neighboring segments must share their end points
+// so the intersection forms polylines, and a ribbon away from the mesh must not intersect it
+
+TEST(IntersectTest, TestCaseMeshIntersector)
+{
+  // Get mesh
+  vtkSmartPointer<vtkPoints> points = vtk_viewer::createPlane();
+  vtkSmartPointer<vtkPolyData> data = vtk_viewer::createMesh(points, 0.5, 5);
+
+  tool_path_planner::MeshIntersector intersector;
+  intersector.setInputMesh(data);
+
+  // create a ribbon crossing the mesh
+  vtkSmartPointer<vtkPoints> ribbon_pts = vtkSmartPointer<vtkPoints>::New();
+  vtkSmartPointer<vtkCellArray> ribbon_cells = vtkSmartPointer<vtkCellArray>::New();
+  for(int i = 0; i < 25; ++i)
+  {
+    double y = -1.0 + 0.5 * i;
+    ribbon_pts->InsertNextPoint(4.3 + 0.1 * y, y, -5.0);
+    ribbon_pts->InsertNextPoint(4.3 + 0.1 * y, y, 5.0);
+    if(i > 0)
+    {
+      vtkIdType start = 2 * (i - 1);
+      vtkIdType tri1[3] = {start, start + 1, start + 3};
+      vtkIdType tri2[3] = {start, start + 3, start + 2};
+      ribbon_cells->InsertNextCell(3, tri1);
+      ribbon_cells->InsertNextCell(3, tri2);
+    }
+  }
+  vtkSmartPointer<vtkPolyData> ribbon = vtkSmartPointer<vtkPolyData>::New();
+  ribbon->SetPoints(ribbon_pts);
+  ribbon->SetPolys(ribbon_cells);
+
+  vtkSmartPointer<vtkPolyData> lines;
+  ASSERT_TRUE(intersector.intersect(ribbon, lines));
+  EXPECT_TRUE(intersector.intersects(ribbon));
+
+  vtkIdTypeArray* cell_ids = vtkIdTypeArray::SafeDownCast(lines->GetCellData()->GetArray(tool_path_planner::MESH_CELL_IDS));
+  ASSERT_TRUE(cell_ids != NULL);
+  EXPECT_EQ(lines->GetNumberOfLines(), cell_ids->GetNumberOfTuples());
+
+  // every point is shared by at most two segments and the polylines have two ends each
+  std::vector<int> count(lines->GetNumberOfPoints(), 0);
+  vtkIdType npts;
+  vtkIdType* pts;
+  vtkCellArray* cells = lines->GetLines();
+  for(cells->InitTraversal(); cells->GetNextCell(npts, pts);)
+  {
+    ++count[pts[0]];
+    ++count[pts[1]];
+  }
+  int ends = 0;
+  for(int i = 0; i < count.size(); ++i)
+  {
+    EXPECT_LE(count[i], 2);
+    ends += count[i] == 1 ? 1 : 0;
+  }
+  EXPECT_EQ(0, ends % 2);
+  EXPECT_EQ(lines->GetNumberOfPoints(), lines->GetNumberOfLines() + ends / 2);
+
+  // move the ribbon away from the mesh
+  for(int i = 0; i < ribbon_pts->GetNumberOfPoints(); ++i)
+  {
+    double pt[3];
+    ribbon_pts->GetPoint(i, pt);
+    pt[0] += 100.0;
+    ribbon_pts->SetPoint(i, pt);
+  }
+  EXPECT_FALSE(intersector.intersects(ribbon));
+}
+
+// This test slices the mesh with parallel planes in one pass, every intersection point must lie on its plane,
+// and plans straight rasters from the same planes
+
+TEST(IntersectTest, TestCaseStraightRasters)
+{
+  // Get mesh
+  vtkSmartPointer<vtkPoints> points = vtk_viewer::createPlane();
+  vtkSmartPointer<vtkPolyData> data = vtk_viewer::createMesh(points, 0.5, 5);
+  vtk_viewer::generateNormals(data);
+
+  tool_path_planner::MeshIntersector intersector;
+  intersector.setInputMesh(data);
+
+  double normal[3] = {0.0, 1.0, 0.0};
+  std::vector<vtkSmartPointer<vtkPolyData> > lines;
+  intersector.slice(normal, 0.25, 0.75, 12, lines);
+  ASSERT_EQ(12, lines.size());
+  for(int i = 0; i < lines.size(); ++i)
+  {
+    EXPECT_GT(lines[i]->GetNumberOfLines(), 0);
+    for(int j = 0; j < lines[i]->GetNumberOfPoints(); ++j)
+    {
+      double pt[3];
+      lines[i]->GetPoints()->GetPoint(j, pt);
+      EXPECT_NEAR(0.25 + i * 0.75, pt[1], 1e-9);
+    }
+  }
+
+  // Set input tool data
+  tool_path_planner::ProcessTool tool;
+  tool.pt_spacing = 0.5;
+  tool.line_spacing = 0.75;
+  tool.tool_offset = 0.0; // currently unused
+  tool.intersecting_plane_height = 0.2;
+  tool.nearest_neighbors = 30;
+  tool.min_hole_size = 0.1;
+  tool.use_ransac_normal_estimation = false;
+  tool.plane_fit_threhold = .01;
+  tool.min_segment_size = 0.01;
+
+  tool_path_planner::RasterToolPathPlanner planner;
+  planner.setTool(tool);
+  planner.setStraightRasters(true);
+  std::vector<tool_path_planner::ProcessPath> paths;
+  planner.planPaths(data, paths);
+  EXPECT_GT(paths.size(), 1);
+}
+
+// This test plans straight rasters on a flat mesh with a hole, the planes crossing the hole cut the mesh in two
+// fragments.  The intersection of every path must be a single polyline, ordered along the plane, holding one point for
+// every mesh edge the plane crosses, with no mesh cell only for the gaps between fragments and the last point
+
+TEST(IntersectTest, TestCaseFragmentStitching)
+{
+  const double size = 10.0;
+  const double step = size / 100.0;  // grid spacing of the 2 * 100 * 100 triangles
+  vtkSmartPointer<vtkPolyData> data = vtk_viewer::createSurfaceMesh(vtk_viewer::SINUSOIDAL_SURFACE, 20000, size, 1);
+
+  // flatten the mesh so the rasters are cut along x by planes of constant y, away from the grid lines
+  for(vtkIdType i = 0; i < data->GetNumberOfPoints(); ++i)
+  {
+    double pt[3];
+    data->GetPoints()->GetPoint(i, pt);
+    pt[2] = 0.0;
+    data->GetPoints()->SetPoint(i, pt);
+  }
+  vtk_viewer::generateNormals(data);
+
+  // Set input tool data
+  tool_path_planner::ProcessTool tool;
+  tool.pt_spacing = 0.2;
+  tool.line_spacing = 0.25;
+  tool.tool_offset = 0.0; // currently unused
+  tool.intersecting_plane_height = 0.2;
+  tool.nearest_neighbors = 5;
+  tool.min_hole_size = 2.0 * size;
+  tool.use_ransac_normal_estimation = false;
+  tool.plane_fit_threhold = .01;
+  tool.min_segment_size = 0.01;
+
+  tool_path_planner::RasterToolPathPlanner planner;
+  planner.setTool(tool);
+  planner.setStraightRasters(true);
+  double direction[3] = {1.0, 0.0, 0.0};
+  double centroid[3] = {0.5 * size, 0.5 * size + 0.025, 0.0};
+  planner.setCutDirection(direction);
+  planner.setCutCentroid(centroid);
+  std::vector<tool_path_planner::ProcessPath> paths;
+  planner.planPaths(data, paths);
+  ASSERT_GT(paths.size(), 1);
+
+  int fragmented = 0;
+  for(int i = 0; i < paths.size(); ++i)
+  {
+    ASSERT_TRUE(paths[i].intersection != NULL);
+    vtkPoints* points = paths[i].intersection->GetPoints();
+    vtkIdTypeArray* cell_ids = vtkIdTypeArray::SafeDownCast(
+          paths[i].intersection->GetPointData()->GetArray(tool_path_planner::MESH_CELL_IDS));
+    ASSERT_TRUE(cell_ids != NULL);
+    ASSERT_EQ(cell_ids->GetNumberOfTuples(), points->GetNumberOfPoints());
+    ASSERT_GT(points->GetNumberOfPoints(), 1);
+
+    // the mesh edges crossed by the plane of the path
+    double y = points->GetPoint(0)[1];
+    std::set<std::pair<vtkIdType, vtkIdType> > edges;
+    vtkIdType npts;
+    vtkIdType* pts;
+    vtkCellArray* polys = data->GetPolys();
+    for(polys->InitTraversal(); polys->GetNextCell(npts, pts);)
+    {
+      for(vtkIdType j = 0; j < npts; ++j)
+      {
+        vtkIdType a = std::min(pts[j], pts[(j + 1) % npts]);
+        vtkIdType b = std::max(pts[j], pts[(j + 1) % npts]);
+        if((data->GetPoint(a)[1] - y) * (data->GetPoint(b)[1] - y) < 0.0)
+        {
+          edges.insert(std::make_pair(a, b));
+        }
+      }
+    }
+    EXPECT_EQ(vtkIdType(edges.size()), points->GetNumberOfPoints()) << "path " << i;
+
+    // consecutive points are at most a grid step apart and move the same way along x, except across the hole
+    double sign = points->GetPoint(points->GetNumberOfPoints() - 1)[0] > points->GetPoint(0)[0] ? 1.0 : -1.0;
+    int gaps = 0;
+    for(vtkIdType j = 0; j + 1 < points->GetNumberOfPoints(); ++j)
+    {
+      double pt1[3], pt2[3];
+      points->GetPoint(j, pt1);
+      points->GetPoint(j + 1, pt2);
+      EXPECT_NEAR(y, pt2[1], 1e-6);
+      EXPECT_GT(sign * (pt2[0] - pt1[0]), 0.0);
+      if(std::sqrt(vtkMath::Distance2BetweenPoints(pt1, pt2)) > 1.5 * step)
+      {
+        ++gaps;
+        EXPECT_EQ(-1, cell_ids->GetValue(j));
+      }
+      else
+      {
+        EXPECT_GE(cell_ids->GetValue(j), 0);
+      }
+    }
+    EXPECT_EQ(-1, cell_ids->GetValue(points->GetNumberOfPoints() - 1));
+    EXPECT_LE(gaps, 1);
+    fragmented += gaps;
+  }
+  EXPECT_GT(fragmented, 0);
+}
+
+// This test fits a spline through unevenly spaced points on a circle and resamples it, the samples must be
+// evenly spaced, stay on the circle, keep the end points and have tangents perpendicular to the radius
+
+TEST(IntersectTest, TestCasePathSpline)
+{
+  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+  double angle = 0.0;
+  for(int i = 0; i < 20; ++i)
+  {
+    points->InsertNextPoint(2.0 * cos(angle), 2.0 * sin(angle), 0.0);
+    angle += 0.05 + 0.1 * (i % 3);
+  }
+
+  tool_path_planner::PathSpline spline;
+  ASSERT_TRUE(spline.setPoints(points));
+
+  std::vector<double> pts, tangents, params;
+  spline.resample(0.1, pts, tangents, params);
+  ASSERT_GT(params.size(), 2);
+  ASSERT_EQ(3 * params.size(), pts.size());
+
+  double first[3], last[3];
+  points->GetPoint(0, first);
+  points->GetPoint(points->GetNumberOfPoints() - 1, last);
+  for(int j = 0; j < 3; ++j)
+  {
+    EXPECT_NEAR(first[j], pts[j], 1e-12);
+    EXPECT_NEAR(last[j], pts[pts.size() - 3 + j], 1e-12);
+  }
+
+  double spacing = spline.getLength() / double(params.size() - 1);
+  for(int i = 0; i < params.size(); ++i)
+  {
+    const double* pt = &pts[3 * i];
+    const double* tangent = &tangents[3 * i];
+    EXPECT_NEAR(2.0, sqrt(pt[0] * pt[0] + pt[1] * pt[1]), 1e-3);
+    EXPECT_NEAR(0.0, (pt[0] * tangent[0] + pt[1] * tangent[1]) / 2.0, 0.05);
+    if(i > 0)
+    {
+      // neighboring samples on a circle are a chord apart
+      double dist = sqrt(vtkMath::Distance2BetweenPoints(pt, &pts[3 * (i - 1)]));
+      EXPECT_NEAR(4.0 * sin(spacing / 4.0), dist, 1e-4);
+    }
+  }
+}
+
+// This test grows rasters at a spacing which needs more than the default number of rasters per side,
+// without a limit the sweeps must continue until they run off the mesh
+
+TEST(IntersectTest, TestCaseUnboundedSweeps)
+{
+  // Get mesh
+  vtkSmartPointer<vtkPoints> points = vtk_viewer::createPlane();
+  vtkSmartPointer<vtkPolyData> data = vtk_viewer::createMesh(points, 0.5, 5);
+  vtk_viewer::generateNormals(data);
+
+  // Set input tool data
+  tool_path_planner::ProcessTool tool;
+  tool.pt_spacing = 0.5;
+  tool.line_spacing = 0.2;
+  tool.tool_offset = 0.0; // currently unused
+  tool.intersecting_plane_height = 0.1;
+  tool.nearest_neighbors = 30;
+  tool.min_hole_size = 0.1;
+  tool.use_ransac_normal_estimation = false;
+  tool.plane_fit_threhold = .01;
+  tool.min_segment_size = 0.01;
+
+  tool_path_planner::RasterToolPathPlanner bounded_planner;
+  bounded_planner.setTool(tool);
+  std::vector<tool_path_planner::ProcessPath> bounded_paths;
+  bounded_planner.planPaths(data, bounded_paths);
+
+  tool_path_planner::RasterToolPathPlanner unbounded_planner;
+  unbounded_planner.setTool(tool);
+  unbounded_planner.setMaxRasters(0);
+  std::vector<tool_path_planner::ProcessPath> unbounded_paths;
+  unbounded_planner.planPaths(data, unbounded_paths);
+
+  EXPECT_GT(unbounded_paths.size(), bounded_paths.size());
+}
+
+// This test estimates ransac normals for the same points with one and with several threads, every point
+// uses its own fixed seed so the normals must be identical
+
+TEST(IntersectTest, TestCaseParallelRansac)
+{
+  // Get mesh
+  vtkSmartPointer<vtkPoints> points = vtk_viewer::createPlane();
+  vtkSmartPointer<vtkPolyData> data = vtk_viewer::createMesh(points, 0.5, 5);
+  vtk_viewer::generateNormals(data);
+
+  // Set input tool data
+  tool_path_planner::ProcessTool tool;
+  tool.pt_spacing = 0.5;
+  tool.line_spacing = 0.75;
+  tool.tool_offset = 0.0; // currently unused
+  tool.intersecting_plane_height = 0.2;
+  tool.nearest_neighbors = 30;
+  tool.min_hole_size = 0.1;
+  tool.use_ransac_normal_estimation = true;
+  tool.plane_fit_threhold = .01;
+  tool.min_segment_size = 0.01;
+
+  tool_path_planner::RasterToolPathPlanner planner(true);
+  planner.setTool(tool);
+  planner.setInputMesh(data);
+
+  vtkSmartPointer<vtkPolyData> serial = vtkSmartPointer<vtkPolyData>::New();
+  serial->SetPoints(data->GetPoints());
+  planner.estimateNewNormalsRansac(serial);
+
+  planner.setNumThreads(4);
+  vtkSmartPointer<vtkPolyData> parallel = vtkSmartPointer<vtkPolyData>::New();
+  parallel->SetPoints(data->GetPoints());
+  planner.estimateNewNormalsRansac(parallel);
+
+  vtkDataArray* serial_normals = serial->GetPointData()->GetNormals();
+  vtkDataArray* parallel_normals = parallel->GetPointData()->GetNormals();
+  ASSERT_EQ(data->GetNumberOfPoints(), parallel_normals->GetNumberOfTuples());
+  for(int i = 0; i < serial_normals->GetNumberOfTuples(); ++i)
+  {
+    double a[3], b[3];
+    serial_normals->GetTuple(i, a);
+    parallel_normals->GetTuple(i, b);
+    EXPECT_EQ(a[0], b[0]);
+    EXPECT_EQ(a[1], b[1]);
+    EXPECT_EQ(a[2], b[2]);
+  }
+}
+
+// This test estimates the path normals from the mesh cells the paths cross, they must be unit length and
+// agree with the normals averaged from the nearest mesh vertices
+
+TEST(IntersectTest, TestCaseBarycentricNormals)
+{
+  // Get mesh
+  vtkSmartPointer<vtkPoints> points = vtk_viewer::createPlane();
+  vtkSmartPointer<vtkPolyData> data = vtk_viewer::createMesh(points, 0.5, 5);
+  vtk_viewer::generateNormals(data);
+
+  // Set input tool data
+  tool_path_planner::ProcessTool tool;
+  tool.pt_spacing = 0.5;
+  tool.line_spacing = 0.75;
+  tool.tool_offset = 0.0; // currently unused
+  tool.intersecting_plane_height = 0.2;
+  tool.nearest_neighbors = 5;
+  tool.min_hole_size = 0.1;
+  tool.use_ransac_normal_estimation = false;
+  tool.plane_fit_threhold = .01;
+  tool.min_segment_size = 0.01;
+
+  tool_path_planner::RasterToolPathPlanner planner;
+  planner.setTool(tool);
+  planner.setNormalEstimation(tool_path_planner::RasterToolPathPlanner::BARYCENTRIC);
+  std::vector<tool_path_planner::ProcessPath> paths;
+  planner.planPaths(data, paths);
+  ASSERT_GT(paths.size(), 0);
+
+  for(int i = 0; i < paths.size(); ++i)
+  {
+    vtkSmartPointer<vtkPolyData> nearest = vtkSmartPointer<vtkPolyData>::New();
+    nearest->SetPoints(paths[i].line->GetPoints());
+    planner.estimateNewNormals(nearest);
+
+    vtkDataArray* normals = paths[i].line->GetPointData()->GetNormals();
+    ASSERT_TRUE(normals != NULL);
+    for(int j = 0; j < normals->GetNumberOfTuples(); ++j)
+    {
+      double n[3], m[3];
+      normals->GetTuple(j, n);
+      nearest->GetPointData()->GetNormals()->GetTuple(j, m);
+      EXPECT_NEAR(1.0, vtkMath::Norm(n), 1e-9);
+      EXPECT_GT(vtkMath::Dot(n, m), 0.9);
+    }
+  }
+}
+
+// This test plans a mesh with a hole without splitting the paths at it, the path points in the hole are on no mesh
+// cell and must take the normals averaged from the nearest mesh vertices
+
+TEST(IntersectTest, TestCaseBarycentricNormalsHoles)
+{
+  const double size = 10.0;
+  vtkSmartPointer<vtkPolyData> data = vtk_viewer::createSurfaceMesh(vtk_viewer::SINUSOIDAL_SURFACE, 20000, size, 1);
+  const double step = size / 100.0;  // grid spacing of the 2 * 100 * 100 triangles
+
+  // Set input tool data
+  tool_path_planner::ProcessTool tool;
+  tool.pt_spacing = 0.2;
+  tool.line_spacing = 0.25;
+  tool.tool_offset = 0.0; // currently unused
+  tool.intersecting_plane_height = 0.2;
+  tool.nearest_neighbors = 5;
+  tool.min_hole_size = 2.0 * size;
+  tool.use_ransac_normal_estimation = false;
+  tool.plane_fit_threhold = .01;
+  tool.min_segment_size = 0.01;
+
+  tool_path_planner::RasterToolPathPlanner planner;
+  planner.setTool(tool);
+  planner.setMaxRasters(0);
+  planner.setNormalEstimation(tool_path_planner::RasterToolPathPlanner::BARYCENTRIC);
+  std::vector<tool_path_planner::ProcessPath> paths;
+  planner.planPaths(data, paths);
+  ASSERT_GT(paths.size(), 0);
+
+  int hole_points = 0;
+  for(int i = 0; i < paths.size(); ++i)
+  {
+    vtkSmartPointer<vtkPolyData> nearest = vtkSmartPointer<vtkPolyData>::New();
+    nearest->SetPoints(paths[i].line->GetPoints());
+    planner.estimateNewNormals(nearest);
+
+    vtkDataArray* normals = paths[i].line->GetPointData()->GetNormals();
+    ASSERT_TRUE(normals != NULL);
+    for(int j = 0; j < normals->GetNumberOfTuples(); ++j)
+    {
+      // a point farther than two grid steps from every mesh vertex is in the hole
+      double pt[3];
+      paths[i].line->GetPoints()->GetPoint(j, pt);
+      double closest = std::numeric_limits<double>::max();
+      for(vtkIdType k = 0; k < data->GetNumberOfPoints(); ++k)
+      {
+        closest = std::min(closest, vtkMath::Distance2BetweenPoints(pt, data->GetPoint(k)));
+      }
+      if(std::sqrt(closest) < 2.0 * step)
+      {
+        continue;
+      }
+
+      ++hole_points;
+      double n[3], m[3];
+      normals->GetTuple(j, n);
+      nearest->GetPointData()->GetNormals()->GetTuple(j, m);
+      EXPECT_NEAR(m[0], n[0], 1e-6);
+      EXPECT_NEAR(m[1], n[1], 1e-6);
+      EXPECT_NEAR(m[2], n[2], 1e-6);
+    }
+  }
+  EXPECT_GT(hole_points, 0);
+}
+
+// This test plans a mesh with a hole, once passing over the hole and once splitting the paths at it, the rasters
+// crossing the hole must be split into more paths with no point in the hole.  The rasters on the same mesh without
+// the hole must stay in one piece
+
+TEST(IntersectTest, TestCaseHoleSplitting)
+{
+  const double size = 10.0;
+  const double step = size / 100.0;  // grid spacing of the 2 * 100 * 100 triangles
+
+  // Set input tool data
+  tool_path_planner::ProcessTool tool;
+  tool.pt_spacing = 0.2;
+  tool.line_spacing = 0.25;
+  tool.tool_offset = 0.0; // currently unused
+  tool.intersecting_plane_height = 0.2;
+  tool.nearest_neighbors = 5;
+  tool.min_hole_size = 0.3;
+  tool.use_ransac_normal_estimation = false;
+  tool.plane_fit_threhold = .01;
+  tool.min_segment_size = 0.01;
+
+  for(int holes = 0; holes <= 1; ++holes)
+  {
+    vtkSmartPointer<vtkPolyData> data = vtk_viewer::createSurfaceMesh(vtk_viewer::SINUSOIDAL_SURFACE, 20000, size,
+                                                                      holes);
+
+    // the hole (1 to 2 wide) is larger than the minimum hole size, but passed over when the minimum is the mesh size
+    std::vector<tool_path_planner::ProcessPath> whole, split;
+    tool_path_planner::RasterToolPathPlanner planner;
+    planner.setMaxRasters(0);
+    tool.min_hole_size = 2.0 * size;
+    planner.setTool(tool);
+    planner.planPaths(data, whole);
+    tool.min_hole_size = 0.3;
+    planner.setTool(tool);
+    planner.planPaths(data, split);
+    ASSERT_GT(whole.size(), 0);
+
+    // a point farther than two grid steps from every mesh vertex is in the hole
+    int hole_points[2] = {0, 0};
+    for(int k = 0; k < 2; ++k)
+    {
+      const std::vector<tool_path_planner::ProcessPath>& paths = k == 0 ? whole : split;
+      for(int i = 0; i < paths.size(); ++i)
+      {
+        for(vtkIdType j = 0; j < paths[i].line->GetNumberOfPoints(); ++j)
+        {
+          double pt[3];
+          paths[i].line->GetPoint(j, pt);
+          double closest = std::numeric_limits<double>::max();
+          for(vtkIdType n = 0; n < data->GetNumberOfPoints(); ++n)
+          {
+            closest = std::min(closest, vtkMath::Distance2BetweenPoints(pt, data->GetPoint(n)));
+          }
+          if(std::sqrt(closest) >= 2.0 * step)
+          {
+            ++hole_points[k];
+          }
+        }
+      }
+    }
+
+    if(holes == 0)
+    {
+      EXPECT_EQ(split.size(), whole.size());
+      EXPECT_EQ(hole_points[0], 0);
+    }
+    else
+    {
+      EXPECT_GT(split.size(), whole.size());
+      EXPECT_GT(hole_points[0], 0);
+    }
+    EXPECT_EQ(hole_points[1], 0);
+  }
+}
+
+// This test plans the same mesh into compact paths and into VTK paths, both must hold the same points,
+// normals and derivatives
+
+TEST(IntersectTest, TestCaseCompactPaths)
+{
+  // Get mesh
+  vtkSmartPointer<vtkPoints> points = vtk_viewer::createPlane();
+  vtkSmartPointer<vtkPolyData> data = vtk_viewer::createMesh(points, 0.5, 5);
+  vtk_viewer::generateNormals(data);
+
+  // Set input tool data
+  tool_path_planner::ProcessTool tool;
+  tool.pt_spacing = 0.5;
+  tool.line_spacing = 0.75;
+  tool.tool_offset = 0.0; // currently unused
+  tool.intersecting_plane_height = 0.1;
+  tool.nearest_neighbors = 30;
+  tool.min_hole_size = 0.1;
+  tool.use_ransac_normal_estimation = false;
+  tool.plane_fit_threhold = .01;
+  tool.min_segment_size = 0.01;
+
+  tool_path_planner::RasterToolPathPlanner planner;
+  planner.setTool(tool);
+  std::vector<tool_path_planner::CompactPath> compact_paths;
+  planner.planPaths(data, compact_paths);
+  std::vector<tool_path_planner::ProcessPath> paths = planner.getPaths();
+
+  ASSERT_FALSE(compact_paths.empty());
+  ASSERT_EQ(compact_paths.size(), paths.size());
+  for(int i = 0; i < paths.size(); ++i)
+  {
+    const tool_path_planner::CompactPath& compact = compact_paths[i];
+    ASSERT_EQ(compact.size(), paths[i].line->GetNumberOfPoints());
+    for(int j = 0; j < compact.size(); ++j)
+    {
+      double pt[3], normal[3], derivative[3];
+      paths[i].line->GetPoint(j, pt);
+      paths[i].line->GetPointData()->GetNormals()->GetTuple(j, normal);
+      paths[i].derivatives->GetPointData()->GetNormals()->GetTuple(j, derivative);
+      for(int k = 0; k < 3; ++k)
+      {
+        EXPECT_DOUBLE_EQ(compact.points[3 * j + k], pt[k]);
+        EXPECT_DOUBLE_EQ(compact.normals[3 * j + k], normal[k]);
+        EXPECT_DOUBLE_EQ(compact.derivatives[3 * j + k], derivative[k]);
+      }
+    }
+  }
+}
+
+// This test plans a mesh without normals in shared mode, the planner must use the mesh points without
+// copying them, leave the mesh unchanged and produce the same paths as in copy mode
+
+TEST(IntersectTest, TestCaseSharedInputMesh)
+{
+  // Get mesh
+  vtkSmartPointer<vtkPoints> points = vtk_viewer::createPlane();
+  vtkSmartPointer<vtkPolyData> data = vtk_viewer::createMesh(points, 0.5, 5);
+
+  // Set input tool data
+  tool_path_planner::ProcessTool tool;
+  tool.pt_spacing = 0.5;
+  tool.line_spacing = 0.75;
+  tool.tool_offset = 0.0; // currently unused
+  tool.intersecting_plane_height = 0.1;
+  tool.nearest_neighbors = 30;
+  tool.min_hole_size = 0.1;
+  tool.use_ransac_normal_estimation = false;
+  tool.plane_fit_threhold = .01;
+  tool.min_segment_size = 0.01;
+
+  tool_path_planner::RasterToolPathPlanner shared_planner;
+  shared_planner.setTool(tool);
+  shared_planner.setShareInputMesh(true);
+  std::vector<tool_path_planner::CompactPath> shared_paths;
+  shared_planner.planPaths(data, shared_paths);
+
+  EXPECT_EQ(shared_planner.getInputMesh()->GetPoints(), data->GetPoints());
+  EXPECT_TRUE(shared_planner.getInputMesh()->GetPointData()->GetNormals() != NULL);
+  EXPECT_TRUE(data->GetPointData()->GetNormals() == NULL);
+  EXPECT_TRUE(data->GetCellData()->GetNormals() == NULL);
+
+  tool_path_planner::RasterToolPathPlanner copy_planner;
+  copy_planner.setTool(tool);
+  std::vector<tool_path_planner::CompactPath> copy_paths;
+  copy_planner.planPaths(data, copy_paths);
+
+  EXPECT_NE(copy_planner.getInputMesh()->GetPoints(), data->GetPoints());
+  ASSERT_FALSE(shared_paths.empty());
+  ASSERT_EQ(shared_paths.size(), copy_paths.size());
+  for(int i = 0; i < shared_paths.size(); ++i)
+  {
+    EXPECT_EQ(shared_paths[i].points, copy_paths[i].points);
+    EXPECT_EQ(shared_paths[i].normals, copy_paths[i].normals);
+  }
+}
+
+// This test collects the planning statistics, the counters must cover the paths which were created and the
+// stage times must fit in the total time.  Without collection the statistics stay zero.
+
+TEST(IntersectTest, TestCaseStats)
+{
+  // Get mesh
+  vtkSmartPointer<vtkPoints> points = vtk_viewer::createPlane();
+  vtkSmartPointer<vtkPolyData> data = vtk_viewer::createMesh(points, 0.5, 5);
+  vtk_viewer::generateNormals(data);
+
+  // Set input tool data
+  tool_path_planner::ProcessTool tool;
+  tool.pt_spacing = 0.5;
+  tool.line_spacing = 0.75;
+  tool.tool_offset = 0.0; // currently unused
+  tool.intersecting_plane_height = 0.1;
+  tool.nearest_neighbors = 30;
+  tool.min_hole_size = 0.1;
+  tool.use_ransac_normal_estimation = false;
+  tool.plane_fit_threhold = .01;
+  tool.min_segment_size = 0.01;
+
+  tool_path_planner::RasterToolPathPlanner planner;
+  planner.setTool(tool);
+  planner.setCollectStats(true);
+  std::vector<tool_path_planner::CompactPath> paths;
+  planner.planPaths(data, paths);
+  tool_path_planner::PlannerStats stats = planner.getStats();
+
+  ASSERT_FALSE(paths.empty());
+  long num_points = 0;
+  for(int i = 0; i < paths.size(); ++i)
+  {
+    num_points += paths[i].size();
+  }
+  EXPECT_GE(stats.points, num_points);
+  EXPECT_GE(stats.intersections, long(paths.size()));
+  EXPECT_GE(stats.kd_tree_queries, num_points);
+  EXPECT_GT(stats.self_intersection_checks, 0);
+  EXPECT_GT(stats.peak_scratch_bytes, 0);
+  EXPECT_GT(stats.total_time, 0.0);
+  EXPECT_LE(stats.setup_time + stats.intersection_time + stats.smoothing_time + stats.normal_estimation_time +
+            stats.hole_check_time + stats.self_intersection_time, stats.total_time);
+
+  tool_path_planner::RasterToolPathPlanner quiet_planner;
+  quiet_planner.setTool(tool);
+  quiet_planner.planPaths(data, paths);
+  EXPECT_EQ(quiet_planner.getStats().points, 0);
+  EXPECT_EQ(quiet_planner.getStats().total_time, 0.0);
+}
+
 int main(int argc, char **argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2016, Southwest Research Institute
+ * All rights reserved.
+ *
+ */
+
+#ifndef CELL_ADJACENCY_H
+#define CELL_ADJACENCY_H
+
+#include <vector>
+
+#include <vtkPolyData.h>
+
+namespace vtk_viewer
+{
+
+  /**
+   * @brief The CellAdjacency class is a table of the cells sharing an edge with each polygon of a mesh and of the
+   * boundary edges (edges of a single polygon) of each polygon, stored in compressed sparse rows.  It is built once
+   * per mesh by sorting the polygon edges in parallel, lookups do not allocate and are safe from any thread.
+   */
+  class CellAdjacency
+  {
+  public:
+
+    /**
+     * @brief build Builds the table for the polygons of a mesh, replacing the previous table.  Cell ids are the ids of
+     * the mesh (verts and lines come first), verts, lines and strips have no neighbors and no boundary edges.
+     * @param mesh The mesh, its cells must not change while the table is used
+     * @param num_threads The number of threads used to build the table, 0 uses the number of hardware threads
+     */
+    void build(vtkPolyData* mesh, int num_threads = 0);
+
+    /**
+     * @brief getNumberOfCells Get the number of cells of the mesh the table was built for
+     * @return The number of cells
+     */
+    vtkIdType getNumberOfCells() const {return offsets_.empty() ? 0 : vtkIdType(offsets_.size()) - 1;}
+
+    /**
+     * @brief getNumberOfNeighbors Get the number of neighbors of a cell
+     * @param cell The cell id, in [0, getNumberOfCells())
+     * @return The number of neighbors
+     */
+    vtkIdType getNumberOfNeighbors(vtkIdType cell) const {return offsets_[cell + 1] - offsets_[cell];}
+
+    /**
+     * @brief getNeighbors Get the cells sharing an edge with a cell, edge by edge in the order of the cell points and
+     * by increasing id for each edge (as vtkPolyData::GetCellNeighbors gives them), a cell sharing two edges is listed
+     * twice
+     * @param cell The cell id, in [0, getNumberOfCells())
+     * @return Pointer to the getNumberOfNeighbors(cell) neighbor ids
+     */
+    const vtkIdType* getNeighbors(vtkIdType cell) const {return neighbors_.data() + offsets_[cell];}
+
+    /**
+     * @brief getNumberOfBoundaryEdges Get the number of edges of a cell which belong to no other cell (the outer
+     * boundary and the holes of the mesh)
+     * @param cell The cell id, in [0, getNumberOfCells())
+     * @return The number of boundary edges
+     */
+    vtkIdType getNumberOfBoundaryEdges(vtkIdType cell) const
+    {
+      return boundary_offsets_[cell + 1] - boundary_offsets_[cell];
+    }
+
+    /**
+     * @brief getBoundaryEdges Get the boundary edges of a cell, in the order of the cell points
+     * @param cell The cell id, in [0, getNumberOfCells())
+     * @return Pointer to 2 * getNumberOfBoundaryEdges(cell) point ids, the lower id of each edge first
+     */
+    const vtkIdType* getBoundaryEdges(vtkIdType cell) const {return boundary_edges_.data() + 2 * boundary_offsets_[cell];}
+
+  private:
+    std::vector<vtkIdType> offsets_;  /**< The neighbors of cell i are neighbors_[offsets_[i]] to neighbors_[offsets_[i + 1] - 1] */
+    std::vector<vtkIdType> neighbors_;  /**< The neighbor ids of all cells */
+    std::vector<vtkIdType> boundary_offsets_;  /**< The boundary edges of cell i are boundary_offsets_[i] to boundary_offsets_[i + 1] - 1 */
+    std::vector<vtkIdType> boundary_edges_;  /**< Point id pairs of the boundary edges of all cells */
+  };
+
+}
+
+#endif // CELL_ADJACENCY_H
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2016, Southwest Research Institute
+ * All rights reserved.
+ *
+ */
+
+#ifndef DEBUG_RECORDER_H
+#define DEBUG_RECORDER_H
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+
+namespace vtk_viewer
+{
+
+  /**
+   * @brief The DebugRecorder class saves snapshots of intermediate polydata to .vtp files for offline replay.
+   * Recording only copies the data into a ring buffer, a background thread writes the files, so the recording
+   * thread is never blocked by the disk.  Files are named <step>_<name>.vtp, the step increases with every record.
+   */
+  class DebugRecorder
+  {
+  public:
+
+    /**
+     * @brief constructor, starts the writer thread
+     * @param capacity The number of snapshots the ring buffer holds, when it is full the oldest snapshot which is
+     * not written yet is dropped
+     */
+    explicit DebugRecorder(int capacity = 64);
+
+    /**
+     * @brief destructor, writes the remaining snapshots and stops the writer thread
+     */
+    ~DebugRecorder();
+
+    /**
+     * @brief setLogDir Set the directory the files are written to, must exist
+     * @param dir The directory
+     */
+    void setLogDir(std::string dir);
+
+    /**
+     * @brief getLogDir Get the directory the files are written to
+     * @return The directory
+     */
+    std::string getLogDir();
+
+    /**
+     * @brief record Copies the data into the ring buffer, safe to call from any thread
+     * @param data The data to save
+     * @param name The name of the step, used in the file name
+     * @return The step number of the snapshot
+     */
+    int record(vtkSmartPointer<vtkPolyData> data, const std::string& name);
+
+    /**
+     * @brief flush Blocks until every snapshot recorded so far is written (or dropped)
+     */
+    void flush();
+
+    /**
+     * @brief getNumWritten Get the number of files written
+     * @return The number of files written
+     */
+    int getNumWritten();
+
+    /**
+     * @brief getNumDropped Get the number of snapshots dropped because the ring buffer was full or the file could not
+     * be written
+     * @return The number of snapshots dropped
+     */
+    int getNumDropped();
+
+  private:
+
+    struct Snapshot
+    {
+      vtkSmartPointer<vtkPolyData> data;  /**< Copy of the recorded data */
+      std::string file;  /**< File name relative to the log directory */
+    };
+
+    /**
+     * @brief writerLoop Main loop of the writer thread, writes snapshots until stopped and the buffer is empty
+     */
+    void writerLoop();
+
+    std::vector<Snapshot> buffer_;  /**< The ring buffer */
+    int head_;  /**< Index of the oldest snapshot in the buffer */
+    int count_;  /**< Number of snapshots in the buffer */
+    int step_;  /**< Step number of the next snapshot */
+    int num_written_;  /**< Number of files written */
+    int num_dropped_;  /**< Number of snapshots dropped */
+    bool writing_;  /**< True while the writer thread writes a snapshot taken from the buffer */
+    bool stop_;  /**< Tells the writer thread to exit once the buffer is empty */
+    std::string log_dir_;  /**< Directory the files are written to */
+    std::mutex mutex_;  /**< Protects the state above */
+    std::condition_variable data_cv_;  /**< Signals the writer thread that a snapshot was recorded */
+    std::condition_variable done_cv_;  /**< Signals flush() that a snapshot was written */
+    std::thread writer_;  /**< The writer thread */
+  };
+
+}
+
+#endif // DEBUG_RECORDER_H
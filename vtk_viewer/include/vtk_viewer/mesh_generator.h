@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2016, Southwest Research Institute
+ * All rights reserved.
+ *
+ */
+
+#ifndef MESH_GENERATOR_H
+#define MESH_GENERATOR_H
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+
+namespace vtk_viewer
+{
+
+  /**
+   * @brief The shapes of the surfaces created by createSurfaceMesh
+   */
+  enum SurfaceType
+  {
+    SINUSOIDAL_SURFACE,  /**< square in XY with one period of a sine wave in x and a cosine wave in y along z */
+    CYLINDRICAL_SURFACE,  /**< half cylinder along x, open on the -z side, as long as its diameter */
+    FREEFORM_SURFACE  /**< square in XY with a few random gaussian bumps and dents along z */
+  };
+
+  /**
+   * @brief createSurfaceMesh Creates a triangulated surface directly from a regular grid (no surface reconstruction),
+   * so meshes of millions of triangles take milliseconds to create.  The mesh has point and cell normals, pointing
+   * +z (outward on the cylinder), and no points which are not used by a triangle.
+   * @param type The shape of the surface
+   * @param triangles The approximate number of triangles before the holes are cut
+   * @param size The side length of the square surfaces, the length and diameter of the cylinder
+   * @param holes The number of circular holes cut at random locations, holes may overlap
+   * @param noise Points are moved by a random distance up to this along z (radially on the cylinder)
+   * @param seed The seed of the random holes, noise and freeform bumps, the same seed gives the same mesh
+   * @return The mesh
+   */
+  vtkSmartPointer<vtkPolyData> createSurfaceMesh(SurfaceType type, long triangles, double size = 1.0, int holes = 0,
+                                                 double noise = 0.0, unsigned int seed = 0);
+
+}
+
+#endif // MESH_GENERATOR_H
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2016, Southwest Research Institute
+ * All rights reserved.
+ *
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vtk_viewer
+{
+
+  class ThreadPool
+  {
+  public:
+
+    /**
+     * @brief constructor, starts the worker threads
+     * @param num_threads The total number of threads used to run tasks (including the calling thread),
+     * 0 uses the number of hardware threads available
+     */
+    explicit ThreadPool(int num_threads = 0);
+    ~ThreadPool();
+
+    /**
+     * @brief getNumThreads Get the number of threads used to run tasks (including the calling thread)
+     * @return The number of threads
+     */
+    int getNumThreads() const {return int(workers_.size()) + 1;}
+
+    /**
+     * @brief parallelFor Runs task(index, thread_id) for every index in [0, count) and blocks until all are done.
+     * Indices are handed out dynamically so the order in which they run is not fixed, tasks should only write to
+     * data owned by their index or by their thread_id (which is in the range [0, getNumThreads()) ).
+     * Must not be called from inside a task running on the same pool.
+     * @param count The number of tasks to run
+     * @param task The function to call for each index
+     */
+    void parallelFor(int count, const std::function<void(int, int)>& task);
+
+    /**
+     * @brief getHardwareThreads Get the number of hardware threads, never less than 1
+     * @return The number of hardware threads
+     */
+    static int getHardwareThreads();
+
+  private:
+
+    /**
+     * @brief workerLoop Main loop for the worker threads, waits for a new job and helps to run it
+     * @param thread_id The id passed to each task run by this thread
+     */
+    void workerLoop(int thread_id);
+
+    /**
+     * @brief runTasks Takes indices from the current job until none are left
+     * @param thread_id The id passed to each task run by this thread
+     */
+    void runTasks(int thread_id);
+
+    std::vector<std::thread> workers_;  /**< The worker threads, the calling thread acts as thread 0 */
+    std::mutex call_mutex_;  /**< Serializes calls to parallelFor from different threads */
+    std::mutex mutex_;  /**< Protects the job state below */
+    std::condition_variable start_cv_;  /**< Signals workers that a new job is available */
+    std::condition_variable done_cv_;  /**< Signals the caller that all workers are done with the job */
+
+    const std::function<void(int, int)>* task_;  /**< The task of the current job */
+    int count_;  /**< The number of indices in the current job */
+    std::atomic<int> next_index_;  /**< The next index to hand out */
+    unsigned long generation_;  /**< Incremented for every job so workers can tell jobs apart */
+    int active_workers_;  /**< The number of workers still running the current job */
+    bool stop_;  /**< Tells the workers to exit */
+    std::exception_ptr error_;  /**< The first exception thrown by a task, rethrown by parallelFor */
+  };
+
+}
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2016, Southwest Research Institute
+ * All rights reserved.
+ *
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <chrono>
+#include <string>
+
+namespace vtk_viewer
+{
+
+  /**
+   * @brief The Trace class collects the spans recorded by TraceSpan while tracing is on and writes them as a Chrome
+   * trace event file (viewable in chrome://tracing or Perfetto), with one lane per thread
+   */
+  class Trace
+  {
+  public:
+
+    /**
+     * @brief start Discards the spans recorded so far and turns tracing on, time 0 of the trace is now
+     */
+    static void start();
+
+    /**
+     * @brief stop Turns tracing off, the recorded spans are kept
+     */
+    static void stop();
+
+    /**
+     * @brief isEnabled Get whether tracing is on
+     * @return True if tracing is on
+     */
+    static bool isEnabled();
+
+    /**
+     * @brief write Writes the recorded spans to a trace event JSON file
+     * @param file The file name
+     * @return False if the file could not be written
+     */
+    static bool write(const std::string& file);
+  };
+
+  /**
+   * @brief The TraceSpan class records the wall time of its scope as a span of the calling thread, it does nothing
+   * (besides checking a flag) if tracing is off
+   */
+  class TraceSpan
+  {
+  public:
+
+    /**
+     * @brief constructor, starts the span
+     * @param name The name of the span, must be a string literal (or outlive the trace)
+     */
+    explicit TraceSpan(const char* name);
+
+    /**
+     * @brief destructor, ends the span and records it
+     */
+    ~TraceSpan();
+
+  private:
+    const char* name_;  /**< The name of the span, NULL if tracing was off at the start of the span */
+    std::chrono::steady_clock::time_point start_;  /**< The start of the span */
+  };
+
+}
+
+#endif // TRACE_H
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2016, Southwest Research Institute
+ * All rights reserved.
+ *
+ */
+
+#include <algorithm>
+
+#include <vtkCellArray.h>
+
+#include <vtk_viewer/cell_adjacency.h>
+#include <vtk_viewer/thread_pool.h>
+#include <vtk_viewer/trace.h>
+
+namespace vtk_viewer
+{
+  namespace
+  {
+    const vtkIdType MIN_PARALLEL_EDGES = 1 << 16;  /**< Fewer half edges are handled on the calling thread only */
+
+    struct HalfEdge
+    {
+      vtkIdType a;  /**< The lower point id of the edge */
+      vtkIdType b;  /**< The higher point id of the edge */
+      vtkIdType cell;  /**< The cell the edge belongs to */
+      vtkIdType index;  /**< The index of the edge in the order of the cells and their points */
+
+      bool operator<(const HalfEdge& other) const
+      {
+        if(a != other.a)
+        {
+          return a < other.a;
+        }
+        if(b != other.b)
+        {
+          return b < other.b;
+        }
+        if(cell != other.cell)
+        {
+          return cell < other.cell;
+        }
+        return index < other.index;
+      }
+
+      bool sameEdge(const HalfEdge& other) const {return a == other.a && b == other.b;}
+    };
+
+    /**
+     * @brief parallelSort Sorts the chunks of the edges in parallel, then merges pairs of sorted chunks in parallel
+     * until one is left
+     * @param edges The edges to sort
+     * @param pool The threads used to sort
+     */
+    void parallelSort(std::vector<HalfEdge>& edges, ThreadPool& pool)
+    {
+      int chunks = pool.getNumThreads();
+      if(chunks == 1 || edges.size() < MIN_PARALLEL_EDGES)
+      {
+        std::sort(edges.begin(), edges.end());
+        return;
+      }
+
+      std::vector<size_t> bounds(chunks + 1);
+      for(int i = 0; i <= chunks; ++i)
+      {
+        bounds[i] = edges.size() * i / chunks;
+      }
+
+      pool.parallelFor(chunks, [&](int i, int)
+      {
+        std::sort(edges.begin() + bounds[i], edges.begin() + bounds[i + 1]);
+      });
+
+      for(int width = 1; width < chunks; width *= 2)
+      {
+        pool.parallelFor((chunks + 2 * width - 1) / (2 * width), [&](int i, int)
+        {
+          int lo = 2 * width * i;
+          int mid = std::min(lo + width, chunks);
+          int hi = std::min(lo + 2 * width, chunks);
+          if(mid < hi)
+          {
+            std::inplace_merge(edges.begin() + bounds[lo], edges.begin() + bounds[mid], edges.begin() + bounds[hi]);
+          }
+        });
+      }
+    }
+
+    /**
+     * @brief forEachGroup Runs a function for every group of half edges of the same edge, in parallel.  The sorted
+     * edges are split in chunks, a chunk handles the groups which start in it.
+     * @param edges The sorted edges
+     * @param pool The threads used
+     * @param func Called with the first and one past the last index of every group
+     */
+    template <class Func>
+    void forEachGroup(const std::vector<HalfEdge>& edges, ThreadPool& pool, const Func& func)
+    {
+      int chunks = edges.size() < MIN_PARALLEL_EDGES ? 1 : pool.getNumThreads();
+      pool.parallelFor(chunks, [&](int chunk, int)
+      {
+        size_t begin = edges.size() * chunk / chunks;
+        size_t end = edges.size() * (chunk + 1) / chunks;
+        while(begin > 0 && begin < edges.size() && edges[begin].sameEdge(edges[begin - 1]))
+        {
+          ++begin;
+        }
+        while(begin < end)
+        {
+          size_t last = begin + 1;
+          while(last < edges.size() && edges[last].sameEdge(edges[begin]))
+          {
+            ++last;
+          }
+          func(begin, last);
+          begin = last;
+        }
+      });
+    }
+  }
+
+  void CellAdjacency::build(vtkPolyData* mesh, int num_threads)
+  {
+    TraceSpan span("CellAdjacency::build");
+
+    vtkIdType num_cells = mesh ? mesh->GetNumberOfCells() : 0;
+    vtkIdType first_poly = mesh ? mesh->GetNumberOfVerts() + mesh->GetNumberOfLines() : 0;
+    vtkCellArray* polys = mesh ? mesh->GetPolys() : NULL;
+    vtkIdType num_polys = polys ? polys->GetNumberOfCells() : 0;
+
+    // the location of every polygon in the connectivity array and the index of its first half edge
+    std::vector<vtkIdType> locations(num_polys);
+    std::vector<vtkIdType> first_edge(num_polys + 1, 0);
+    const vtkIdType* conn = num_polys > 0 ? polys->GetPointer() : NULL;
+    vtkIdType location = 0;
+    for(vtkIdType i = 0; i < num_polys; ++i)
+    {
+      locations[i] = location;
+      first_edge[i + 1] = first_edge[i] + conn[location];
+      location += conn[location] + 1;
+    }
+    vtkIdType num_edges = first_edge[num_polys];
+
+    ThreadPool pool(num_edges < MIN_PARALLEL_EDGES ? 1 : num_threads);
+    int chunks = pool.getNumThreads();
+
+    std::vector<HalfEdge> edges(num_edges);
+    pool.parallelFor(chunks, [&](int chunk, int)
+    {
+      for(vtkIdType i = num_polys * chunk / chunks; i < num_polys * (chunk + 1) / chunks; ++i)
+      {
+        const vtkIdType* pts = conn + locations[i] + 1;
+        vtkIdType npts = pts[-1];
+        for(vtkIdType j = 0; j < npts; ++j)
+        {
+          HalfEdge& edge = edges[first_edge[i] + j];
+          edge.a = std::min(pts[j], pts[(j + 1) % npts]);
+          edge.b = std::max(pts[j], pts[(j + 1) % npts]);
+          edge.cell = first_poly + i;
+          edge.index = first_edge[i] + j;
+        }
+      }
+    });
+
+    parallelSort(edges, pool);
+
+    // count the neighbors across every half edge and mark the edges of a single cell, in the order of the cells
+    std::vector<vtkIdType> edge_offsets(num_edges + 1, 0);
+    std::vector<vtkIdType> boundary_flags(num_edges + 1, 0);
+    forEachGroup(edges, pool, [&](size_t begin, size_t end)
+    {
+      for(size_t i = begin; i < end; ++i)
+      {
+        vtkIdType count = 0;
+        for(size_t j = begin; j < end; ++j)
+        {
+          count += edges[j].cell != edges[i].cell;
+        }
+        edge_offsets[edges[i].index + 1] = count;
+        boundary_flags[edges[i].index + 1] = end - begin == 1;
+      }
+    });
+    for(vtkIdType i = 0; i < num_edges; ++i)
+    {
+      edge_offsets[i + 1] += edge_offsets[i];
+      boundary_flags[i + 1] += boundary_flags[i];
+    }
+
+    // the rows of the cells before the polygons are empty, as are the rows of the strips after them
+    offsets_.assign(num_cells + 1, edge_offsets[num_edges]);
+    boundary_offsets_.assign(num_cells + 1, boundary_flags[num_edges]);
+    for(vtkIdType i = 0; i < first_poly; ++i)
+    {
+      offsets_[i] = 0;
+      boundary_offsets_[i] = 0;
+    }
+    for(vtkIdType i = 0; i < num_polys; ++i)
+    {
+      offsets_[first_poly + i] = edge_offsets[first_edge[i]];
+      boundary_offsets_[first_poly + i] = boundary_flags[first_edge[i]];
+    }
+
+    neighbors_.resize(edge_offsets[num_edges]);
+    boundary_edges_.resize(2 * boundary_flags[num_edges]);
+    forEachGroup(edges, pool, [&](size_t begin, size_t end)
+    {
+      for(size_t i = begin; i < end; ++i)
+      {
+        vtkIdType next = edge_offsets[edges[i].index];
+        for(size_t j = begin; j < end; ++j)
+        {
+          if(edges[j].cell != edges[i].cell)
+          {
+            neighbors_[next++] = edges[j].cell;
+          }
+        }
+      }
+      if(end - begin == 1)
+      {
+        vtkIdType index = boundary_flags[edges[begin].index];
+        boundary_edges_[2 * index] = edges[begin].a;
+        boundary_edges_[2 * index + 1] = edges[begin].b;
+      }
+    });
+  }
+
+}
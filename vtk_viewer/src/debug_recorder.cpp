@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2016, Southwest Research Institute
+ * All rights reserved.
+ *
+ */
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <boost/filesystem.hpp>
+#include <vtkXMLPolyDataWriter.h>
+
+#include <vtk_viewer/debug_recorder.h>
+
+namespace vtk_viewer
+{
+
+  DebugRecorder::DebugRecorder(int capacity):
+    buffer_(capacity > 0 ? capacity : 1),
+    head_(0),
+    count_(0),
+    step_(0),
+    num_written_(0),
+    num_dropped_(0),
+    writing_(false),
+    stop_(false)
+  {
+    writer_ = std::thread(&DebugRecorder::writerLoop, this);
+  }
+
+  DebugRecorder::~DebugRecorder()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    data_cv_.notify_all();
+    writer_.join();
+  }
+
+  void DebugRecorder::setLogDir(std::string dir)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    log_dir_ = dir;
+  }
+
+  std::string DebugRecorder::getLogDir()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return log_dir_;
+  }
+
+  int DebugRecorder::record(vtkSmartPointer<vtkPolyData> data, const std::string& name)
+  {
+    // copy outside of the lock, the data may be changed by the caller once this returns
+    vtkSmartPointer<vtkPolyData> copy = vtkSmartPointer<vtkPolyData>::New();
+    if(data)
+    {
+      copy->DeepCopy(data);
+    }
+
+    int step;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      step = step_++;
+
+      std::stringstream file;
+      file << std::setw(6) << std::setfill('0') << step << "_" << name << ".vtp";
+
+      // drop the oldest snapshot instead of waiting for the writer
+      if(count_ == buffer_.size())
+      {
+        buffer_[head_] = Snapshot();
+        head_ = (head_ + 1) % buffer_.size();
+        --count_;
+        ++num_dropped_;
+      }
+
+      Snapshot& snapshot = buffer_[(head_ + count_) % buffer_.size()];
+      snapshot.data = copy;
+      snapshot.file = file.str();
+      ++count_;
+    }
+    data_cv_.notify_one();
+    return step;
+  }
+
+  void DebugRecorder::flush()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this]{return count_ == 0 && !writing_;});
+  }
+
+  int DebugRecorder::getNumWritten()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_written_;
+  }
+
+  int DebugRecorder::getNumDropped()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_dropped_;
+  }
+
+  void DebugRecorder::writerLoop()
+  {
+    vtkSmartPointer<vtkXMLPolyDataWriter> writer = vtkSmartPointer<vtkXMLPolyDataWriter>::New();
+    std::unique_lock<std::mutex> lock(mutex_);
+    while(true)
+    {
+      data_cv_.wait(lock, [this]{return count_ > 0 || stop_;});
+      if(count_ == 0)
+      {
+        return;  // stopped and everything is written
+      }
+
+      Snapshot snapshot = buffer_[head_];
+      buffer_[head_] = Snapshot();
+      head_ = (head_ + 1) % buffer_.size();
+      --count_;
+      writing_ = true;
+      std::string dir = log_dir_;
+      lock.unlock();
+
+      bool written = false;
+      if(boost::filesystem::is_directory(dir))
+      {
+        writer->SetFileName((boost::filesystem::path(dir) / snapshot.file).string().c_str());
+        writer->SetInputData(snapshot.data);
+        written = writer->Write() == 1;
+      }
+      else
+      {
+        std::cout << "Directory " << dir << " does not exist.  Not saving " << snapshot.file << std::endl;
+      }
+
+      lock.lock();
+      writing_ = false;
+      if(written)
+      {
+        ++num_written_;
+      }
+      else
+      {
+        ++num_dropped_;
+      }
+      done_cv_.notify_all();
+    }
+  }
+
+}
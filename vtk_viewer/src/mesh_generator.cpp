@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2016, Southwest Research Institute
+ * All rights reserved.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkDoubleArray.h>
+#include <vtkMath.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+
+#include <vtk_viewer/mesh_generator.h>
+#include <vtk_viewer/trace.h>
+
+namespace vtk_viewer
+{
+  namespace
+  {
+    const int FREEFORM_BUMPS = 6;  /**< Number of gaussian bumps of the freeform surface */
+
+    struct Bump
+    {
+      double x;  /**< Center of the bump */
+      double y;  /**< Center of the bump */
+      double height;  /**< Height of the bump, negative for a dent */
+      double sigma;  /**< Width of the bump */
+    };
+
+    struct Hole
+    {
+      double u;  /**< Center of the hole on the grid */
+      double v;  /**< Center of the hole on the grid */
+      double radius;  /**< Radius of the hole on the grid */
+    };
+
+    /**
+     * @brief surfacePoint Computes a point of the surface from its grid coordinates
+     * @param type The shape of the surface
+     * @param u The grid coordinate along x, from 0 to size
+     * @param v The grid coordinate along y (around the cylinder), from 0 to size
+     * @param size The side length of the surface
+     * @param bumps The bumps of the freeform surface
+     * @param offset The noise added along z (radially on the cylinder)
+     * @param pt [output] The point
+     */
+    void surfacePoint(SurfaceType type, double u, double v, double size, const std::vector<Bump>& bumps,
+                      double offset, double* pt)
+    {
+      switch(type)
+      {
+        case CYLINDRICAL_SURFACE:
+        {
+          // theta goes from pi to 0 as v increases so the triangles face outward
+          double radius = 0.5 * size + offset;
+          double theta = vtkMath::Pi() * (1.0 - v / size);
+          pt[0] = u;
+          pt[1] = radius * std::cos(theta);
+          pt[2] = radius * std::sin(theta);
+          return;
+        }
+        case FREEFORM_SURFACE:
+        {
+          double z = 0.0;
+          for(int i = 0; i < bumps.size(); ++i)
+          {
+            double dx = u - bumps[i].x;
+            double dy = v - bumps[i].y;
+            z += bumps[i].height * std::exp(-(dx * dx + dy * dy) / (2.0 * bumps[i].sigma * bumps[i].sigma));
+          }
+          pt[0] = u;
+          pt[1] = v;
+          pt[2] = z + offset;
+          return;
+        }
+        default:
+        {
+          pt[0] = u;
+          pt[1] = v;
+          pt[2] = 0.05 * size * std::sin(2.0 * vtkMath::Pi() * u / size) * std::cos(2.0 * vtkMath::Pi() * v / size)
+              + offset;
+          return;
+        }
+      }
+    }
+  }
+
+  vtkSmartPointer<vtkPolyData> createSurfaceMesh(SurfaceType type, long triangles, double size, int holes,
+                                                 double noise, unsigned int seed)
+  {
+    TraceSpan span("createSurfaceMesh");
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    std::vector<Bump> bumps;
+    if(type == FREEFORM_SURFACE)
+    {
+      for(int i = 0; i < FREEFORM_BUMPS; ++i)
+      {
+        Bump bump;
+        bump.x = uniform(rng) * size;
+        bump.y = uniform(rng) * size;
+        bump.height = (2.0 * uniform(rng) - 1.0) * 0.1 * size;
+        bump.sigma = (0.1 + 0.2 * uniform(rng)) * size;
+        bumps.push_back(bump);
+      }
+    }
+
+    // keep the holes away from the border so they do not split the surface
+    std::vector<Hole> hole_list;
+    for(int i = 0; i < holes; ++i)
+    {
+      Hole hole;
+      hole.u = (0.2 + 0.6 * uniform(rng)) * size;
+      hole.v = (0.2 + 0.6 * uniform(rng)) * size;
+      hole.radius = (0.05 + 0.05 * uniform(rng)) * size;
+      hole_list.push_back(hole);
+    }
+
+    // each square of the n x n point grid is split into two triangles
+    const int n = std::max(2, int(std::sqrt(std::max(triangles, 2L) / 2.0) + 0.5) + 1);
+    const double step = size / (n - 1);
+
+    // find the squares outside of the holes and mark the grid points they use
+    std::vector<char> keep((n - 1) * (n - 1), 1);
+    std::vector<vtkIdType> point_ids(n * n, -1);
+    vtkIdType num_squares = 0;
+    for(int i = 0; i + 1 < n; ++i)
+    {
+      for(int j = 0; j + 1 < n; ++j)
+      {
+        double u = (i + 0.5) * step;
+        double v = (j + 0.5) * step;
+        for(int k = 0; k < hole_list.size(); ++k)
+        {
+          double du = u - hole_list[k].u;
+          double dv = v - hole_list[k].v;
+          if(du * du + dv * dv < hole_list[k].radius * hole_list[k].radius)
+          {
+            keep[i * (n - 1) + j] = 0;
+            break;
+          }
+        }
+
+        if(keep[i * (n - 1) + j])
+        {
+          ++num_squares;
+          int p0 = i * n + j;
+          point_ids[p0] = point_ids[p0 + 1] = point_ids[p0 + n] = point_ids[p0 + n + 1] = 0;
+        }
+      }
+    }
+
+    // number the used grid points and compute their location, noise is drawn for every grid point so the holes do
+    // not change the rest of the surface
+    vtkIdType num_points = 0;
+    for(int k = 0; k < n * n; ++k)
+    {
+      if(point_ids[k] == 0)
+      {
+        point_ids[k] = num_points++;
+      }
+    }
+
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->SetDataTypeToDouble();
+    points->SetNumberOfPoints(num_points);
+    for(int i = 0; i < n; ++i)
+    {
+      for(int j = 0; j < n; ++j)
+      {
+        double offset = noise > 0.0 ? (2.0 * uniform(rng) - 1.0) * noise : 0.0;
+        if(point_ids[i * n + j] >= 0)
+        {
+          double pt[3];
+          surfacePoint(type, i * step, j * step, size, bumps, offset, pt);
+          points->SetPoint(point_ids[i * n + j], pt);
+        }
+      }
+    }
+
+    // two triangles per square, counterclockwise seen from +z (from outside the cylinder)
+    vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
+    vtkIdType* conn = cells->WritePointer(2 * num_squares, 8 * num_squares);
+    for(int i = 0; i + 1 < n; ++i)
+    {
+      for(int j = 0; j + 1 < n; ++j)
+      {
+        if(!keep[i * (n - 1) + j])
+        {
+          continue;
+        }
+
+        int p0 = i * n + j;
+        conn[0] = 3;
+        conn[1] = point_ids[p0];
+        conn[2] = point_ids[p0 + n];
+        conn[3] = point_ids[p0 + n + 1];
+        conn[4] = 3;
+        conn[5] = point_ids[p0];
+        conn[6] = point_ids[p0 + n + 1];
+        conn[7] = point_ids[p0 + 1];
+        conn += 8;
+      }
+    }
+
+    // cell normals from the triangles, point normals as the area weighted average of the cells around the point
+    vtkSmartPointer<vtkDoubleArray> cell_normals = vtkSmartPointer<vtkDoubleArray>::New();
+    cell_normals->SetName("Normals");
+    cell_normals->SetNumberOfComponents(3);
+    cell_normals->SetNumberOfTuples(2 * num_squares);
+
+    std::vector<double> point_normals(3 * num_points, 0.0);
+    vtkIdType npts;
+    vtkIdType* pts;
+    vtkIdType cell = 0;
+    for(cells->InitTraversal(); cells->GetNextCell(npts, pts); ++cell)
+    {
+      double a[3], b[3], c[3], ab[3], ac[3], norm[3];
+      points->GetPoint(pts[0], a);
+      points->GetPoint(pts[1], b);
+      points->GetPoint(pts[2], c);
+      vtkMath::Subtract(b, a, ab);
+      vtkMath::Subtract(c, a, ac);
+      vtkMath::Cross(ab, ac, norm);
+      for(int k = 0; k < 3; ++k)
+      {
+        for(int m = 0; m < 3; ++m)
+        {
+          point_normals[3 * pts[k] + m] += norm[m];
+        }
+      }
+      vtkMath::Normalize(norm);
+      cell_normals->SetTuple(cell, norm);
+    }
+
+    vtkSmartPointer<vtkDoubleArray> normals = vtkSmartPointer<vtkDoubleArray>::New();
+    normals->SetName("Normals");
+    normals->SetNumberOfComponents(3);
+    normals->SetNumberOfTuples(num_points);
+    for(vtkIdType i = 0; i < num_points; ++i)
+    {
+      vtkMath::Normalize(&point_normals[3 * i]);
+      normals->SetTuple(i, &point_normals[3 * i]);
+    }
+
+    vtkSmartPointer<vtkPolyData> mesh = vtkSmartPointer<vtkPolyData>::New();
+    mesh->SetPoints(points);
+    mesh->SetPolys(cells);
+    mesh->GetPointData()->SetNormals(normals);
+    mesh->GetCellData()->SetNormals(cell_normals);
+    return mesh;
+  }
+
+}
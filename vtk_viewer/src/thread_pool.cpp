@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2016, Southwest Research Institute
+ * All rights reserved.
+ *
+ */
+
+#include <vtk_viewer/thread_pool.h>
+
+namespace vtk_viewer
+{
+
+  ThreadPool::ThreadPool(int num_threads):
+    task_(NULL),
+    count_(0),
+    next_index_(0),
+    generation_(0),
+    active_workers_(0),
+    stop_(false)
+  {
+    if(num_threads <= 0)
+    {
+      num_threads = getHardwareThreads();
+    }
+
+    // the calling thread also runs tasks, so one less worker is needed
+    for(int i = 1; i < num_threads; ++i)
+    {
+      workers_.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+    }
+  }
+
+  ThreadPool::~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    start_cv_.notify_all();
+
+    for(int i = 0; i < workers_.size(); ++i)
+    {
+      workers_[i].join();
+    }
+  }
+
+  int ThreadPool::getHardwareThreads()
+  {
+    int num = std::thread::hardware_concurrency();
+    return num > 0 ? num : 1;
+  }
+
+  void ThreadPool::parallelFor(int count, const std::function<void(int, int)>& task)
+  {
+    if(count <= 0)
+    {
+      return;
+    }
+
+    // nothing to share, run everything on the calling thread
+    if(workers_.empty() || count == 1)
+    {
+      for(int i = 0; i < count; ++i)
+      {
+        task(i, 0);
+      }
+      return;
+    }
+
+    std::lock_guard<std::mutex> call_lock(call_mutex_);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      task_ = &task;
+      count_ = count;
+      next_index_ = 0;
+      error_ = std::exception_ptr();
+      active_workers_ = workers_.size();
+      ++generation_;
+    }
+    start_cv_.notify_all();
+
+    runTasks(0);
+
+    // wait for all workers to finish with this job before the task goes out of scope
+    std::unique_lock<std::mutex> lock(mutex_);
+    while(active_workers_ > 0)
+    {
+      done_cv_.wait(lock);
+    }
+    task_ = NULL;
+
+    if(error_)
+    {
+      std::exception_ptr error = error_;
+      error_ = std::exception_ptr();
+      std::rethrow_exception(error);
+    }
+  }
+
+  void ThreadPool::workerLoop(int thread_id)
+  {
+    unsigned long last_generation = 0;
+    while(true)
+    {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while(!stop_ && generation_ == last_generation)
+        {
+          start_cv_.wait(lock);
+        }
+        if(stop_)
+        {
+          return;
+        }
+        last_generation = generation_;
+      }
+
+      runTasks(thread_id);
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      if(--active_workers_ == 0)
+      {
+        done_cv_.notify_all();
+      }
+    }
+  }
+
+  void ThreadPool::runTasks(int thread_id)
+  {
+    while(true)
+    {
+      int index = next_index_++;
+      if(index >= count_)
+      {
+        break;
+      }
+
+      try
+      {
+        (*task_)(index, thread_id);
+      }
+      catch(...)
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(!error_)
+        {
+          error_ = std::current_exception();
+        }
+      }
+    }
+  }
+
+}
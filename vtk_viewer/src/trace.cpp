@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2016, Southwest Research Institute
+ * All rights reserved.
+ *
+ */
+
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+#include <vtk_viewer/trace.h>
+
+namespace vtk_viewer
+{
+  namespace
+  {
+    struct TraceEvent
+    {
+      const char* name;  /**< The name of the span */
+      double start;  /**< Start of the span in microseconds since the trace started */
+      double duration;  /**< Duration of the span in microseconds */
+      int thread_id;  /**< The thread which recorded the span */
+    };
+
+    std::atomic<bool> trace_enabled(false);  /**< True while tracing is on */
+    std::atomic<int> next_thread_id(0);  /**< The trace id of the next thread recording its first span */
+    std::mutex trace_mutex;  /**< Protects the state below */
+    std::chrono::steady_clock::time_point trace_start;  /**< Time 0 of the trace */
+    std::vector<TraceEvent> trace_events;  /**< The spans recorded since the trace started */
+
+    /**
+     * @brief getThreadId Gets the trace id of the calling thread, threads are numbered in the order they record spans
+     * @return The id
+     */
+    int getThreadId()
+    {
+      thread_local int id = next_thread_id++;
+      return id;
+    }
+
+    /**
+     * @brief writeString Writes a JSON string, quoting the characters which need it
+     * @param out The stream
+     * @param str The string
+     */
+    void writeString(std::ostream& out, const char* str)
+    {
+      out << '"';
+      for(; *str; ++str)
+      {
+        if(*str == '"' || *str == '\\')
+        {
+          out << '\\';
+        }
+        out << *str;
+      }
+      out << '"';
+    }
+  }
+
+  void Trace::start()
+  {
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    trace_events.clear();
+    trace_start = std::chrono::steady_clock::now();
+    trace_enabled = true;
+  }
+
+  void Trace::stop()
+  {
+    trace_enabled = false;
+  }
+
+  bool Trace::isEnabled()
+  {
+    return trace_enabled.load(std::memory_order_relaxed);
+  }
+
+  bool Trace::write(const std::string& file)
+  {
+    std::ofstream out(file.c_str());
+    if(!out)
+    {
+      return false;
+    }
+
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for(int i = 0; i < trace_events.size(); ++i)
+    {
+      const TraceEvent& event = trace_events[i];
+      out << (i > 0 ? ",\n" : "\n") << "{\"name\":";
+      writeString(out, event.name);
+      out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread_id << ",\"ts\":" << event.start
+          << ",\"dur\":" << event.duration << "}";
+    }
+    out << "\n]}\n";
+    return bool(out);
+  }
+
+  TraceSpan::TraceSpan(const char* name):
+    name_(Trace::isEnabled() ? name : NULL)
+  {
+    if(name_)
+    {
+      start_ = std::chrono::steady_clock::now();
+    }
+  }
+
+  TraceSpan::~TraceSpan()
+  {
+    if(!name_ || !Trace::isEnabled())
+    {
+      return;
+    }
+
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    TraceEvent event;
+    event.name = name_;
+    event.duration = std::chrono::duration<double, std::micro>(end - start_).count();
+    event.thread_id = getThreadId();
+
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    event.start = std::chrono::duration<double, std::micro>(start_ - trace_start).count();
+    trace_events.push_back(event);
+  }
+
+}
@@ -49,6 +49,8 @@
 #include <vtkImplicitSelectionLoop.h>
 #include <vtkClipPolyData.h>
 
+#include <vtk_viewer/trace.h>
+
 
 namespace vtk_viewer
 {
@@ -377,6 +379,8 @@ vtkSmartPointer<vtkPolyData> estimateCurvature(vtkSmartPointer<vtkPolyData> mesh
 
 void generateNormals(vtkSmartPointer<vtkPolyData>& data, int flip_normals)
 {
+  TraceSpan span("generateNormals");
+
   // If point data exists but cell data does not, iterate through the cells and generate normals manually
   if(data->GetPointData()->GetNormals() && !data->GetCellData()->GetNormals())
   {
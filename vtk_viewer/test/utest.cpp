@@ -6,8 +6,17 @@
 
 #include <vtk_viewer/vtk_utils.h>
 #include <vtk_viewer/vtk_viewer.h>
+#include <vtk_viewer/debug_recorder.h>
+#include <vtk_viewer/trace.h>
+#include <vtk_viewer/mesh_generator.h>
+#include <vtk_viewer/cell_adjacency.h>
 #include <vtkPointData.h>
 #include <gtest/gtest.h>
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
 
 // This test shows the results of meshing on a square grid that has a sinusoidal
 // variability in the z axis.  Red arrows show the surface normal for each triangle
@@ -69,6 +78,142 @@ TEST(ViewerTest, TestCase1)
 
 }
 
+// This test records a mesh several times, every snapshot must be written to a numbered file in the
+// log directory once the recorder is flushed
+
+TEST(ViewerTest, TestCaseDebugRecorder)
+{
+  vtkSmartPointer<vtkPoints> points = vtk_viewer::createPlane();
+  vtkSmartPointer<vtkPolyData> data = vtk_viewer::createMesh(points, 0.5, 5);
+
+  boost::filesystem::path dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  ASSERT_TRUE(boost::filesystem::create_directories(dir));
+
+  vtk_viewer::DebugRecorder recorder(16);
+  recorder.setLogDir(dir.string());
+  for(int i = 0; i < 10; ++i)
+  {
+    EXPECT_EQ(recorder.record(data, "mesh"), i);
+  }
+  recorder.flush();
+
+  EXPECT_EQ(recorder.getNumWritten(), 10);
+  EXPECT_EQ(recorder.getNumDropped(), 0);
+  EXPECT_TRUE(boost::filesystem::exists(dir / "000000_mesh.vtp"));
+  EXPECT_TRUE(boost::filesystem::exists(dir / "000009_mesh.vtp"));
+
+  boost::filesystem::remove_all(dir);
+}
+
+// This test traces spans on two threads, both must be written to the trace file in their own lane and spans
+// outside of the trace must be left out
+
+TEST(ViewerTest, TestCaseTrace)
+{
+  vtk_viewer::Trace::start();
+  {
+    vtk_viewer::TraceSpan span("outer");
+    std::thread worker([]{vtk_viewer::TraceSpan span("worker");});
+    worker.join();
+  }
+  vtk_viewer::Trace::stop();
+  {
+    vtk_viewer::TraceSpan span("ignored");
+  }
+
+  boost::filesystem::path file = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%%%.json");
+  ASSERT_TRUE(vtk_viewer::Trace::write(file.string()));
+
+  std::ifstream in(file.string().c_str());
+  std::stringstream trace;
+  trace << in.rdbuf();
+  boost::filesystem::remove(file);
+
+  std::string text = trace.str();
+  size_t outer = text.find("\"name\":\"outer\"");
+  size_t worker = text.find("\"name\":\"worker\"");
+  ASSERT_NE(outer, std::string::npos);
+  ASSERT_NE(worker, std::string::npos);
+  EXPECT_EQ(text.find("ignored"), std::string::npos);
+
+  // the thread id follows the name of every event
+  size_t outer_tid = text.find("\"tid\":", outer);
+  size_t worker_tid = text.find("\"tid\":", worker);
+  EXPECT_NE(text.substr(outer_tid, text.find(',', outer_tid) - outer_tid),
+            text.substr(worker_tid, text.find(',', worker_tid) - worker_tid));
+}
+
+// This test creates each kind of generated surface, the triangle count must be close to the requested one, holes
+// must remove triangles and the same seed must give the same mesh
+
+TEST(ViewerTest, TestCaseSurfaceMesh)
+{
+  const vtk_viewer::SurfaceType types[] = {vtk_viewer::SINUSOIDAL_SURFACE, vtk_viewer::CYLINDRICAL_SURFACE,
+                                           vtk_viewer::FREEFORM_SURFACE};
+  for(int i = 0; i < 3; ++i)
+  {
+    vtkSmartPointer<vtkPolyData> mesh = vtk_viewer::createSurfaceMesh(types[i], 20000);
+    EXPECT_NEAR(mesh->GetNumberOfPolys(), 20000, 1000);
+    ASSERT_TRUE(mesh->GetPointData()->GetNormals());
+    EXPECT_EQ(mesh->GetPointData()->GetNormals()->GetNumberOfTuples(), mesh->GetNumberOfPoints());
+    EXPECT_EQ(mesh->GetCellData()->GetNormals()->GetNumberOfTuples(), mesh->GetNumberOfPolys());
+
+    vtkSmartPointer<vtkPolyData> holes = vtk_viewer::createSurfaceMesh(types[i], 20000, 1.0, 3, 0.001, 7);
+    vtkSmartPointer<vtkPolyData> same = vtk_viewer::createSurfaceMesh(types[i], 20000, 1.0, 3, 0.001, 7);
+    EXPECT_LT(holes->GetNumberOfPolys(), mesh->GetNumberOfPolys());
+    EXPECT_LT(holes->GetNumberOfPoints(), mesh->GetNumberOfPoints());
+    ASSERT_EQ(holes->GetNumberOfPoints(), same->GetNumberOfPoints());
+    for(vtkIdType j = 0; j < holes->GetNumberOfPoints(); j += 97)
+    {
+      double pt1[3], pt2[3];
+      holes->GetPoint(j, pt1);
+      same->GetPoint(j, pt2);
+      EXPECT_EQ(vtk_viewer::pt_dist(pt1, pt2), 0.0);
+    }
+  }
+}
+
+// This test builds the cell adjacency of a surface with holes on several threads, the neighbors must be the ones
+// (and in the order) vtkPolyData::GetCellNeighbors finds edge by edge, and edges without neighbors must be boundary edges
+
+TEST(ViewerTest, TestCaseCellAdjacency)
+{
+  vtkSmartPointer<vtkPolyData> mesh = vtk_viewer::createSurfaceMesh(vtk_viewer::FREEFORM_SURFACE, 100000, 1.0, 3);
+  mesh->BuildLinks();
+
+  vtk_viewer::CellAdjacency adjacency;
+  adjacency.build(mesh, 4);
+  ASSERT_EQ(adjacency.getNumberOfCells(), mesh->GetNumberOfCells());
+
+  vtkSmartPointer<vtkIdList> edge = vtkSmartPointer<vtkIdList>::New();
+  vtkSmartPointer<vtkIdList> edge_neighbors = vtkSmartPointer<vtkIdList>::New();
+  for(vtkIdType i = 0; i < mesh->GetNumberOfCells(); ++i)
+  {
+    vtkIdType npts;
+    vtkIdType* pts;
+    mesh->GetCellPoints(i, npts, pts);
+
+    std::vector<vtkIdType> neighbors;
+    int boundary_edges = 0;
+    for(vtkIdType j = 0; j < npts; ++j)
+    {
+      edge->Reset();
+      edge->InsertNextId(pts[j]);
+      edge->InsertNextId(pts[(j + 1) % npts]);
+      mesh->GetCellNeighbors(i, edge, edge_neighbors);
+      for(vtkIdType k = 0; k < edge_neighbors->GetNumberOfIds(); ++k)
+      {
+        neighbors.push_back(edge_neighbors->GetId(k));
+      }
+      boundary_edges += edge_neighbors->GetNumberOfIds() == 0;
+    }
+
+    ASSERT_EQ(adjacency.getNumberOfNeighbors(i), neighbors.size());
+    EXPECT_TRUE(std::equal(neighbors.begin(), neighbors.end(), adjacency.getNeighbors(i)));
+    EXPECT_EQ(adjacency.getNumberOfBoundaryEdges(i), boundary_edges);
+  }
+}
+
 // Run all the tests that were declared with TEST()
 int main(int argc, char **argv)
 {